@@ -4,11 +4,13 @@
 // There is no good implementation of std::make_pair in Qt. So I am sticking with the standard C++ container here
 #include <vector>
 #include <string>
+#include <algorithm>
 
 // Qt includes
 #include <QtSql/QSqlQuery>
 #include <QVariant>
 #include <QVector>
+#include <QStringList>
 
 // ROOT includes
 #include <TObjString.h>
@@ -24,20 +26,29 @@ struct Base_Type {
     virtual ~Base_Type() {
     }
 
-    virtual void setFromResultset(const QSqlQuery& rs, int field_no) = 0;
+    /**
+     * set the branch value from a single cell of a result row
+     */
+    virtual void setFromValue(const QVariant& v) = 0;
+
+    virtual void setFromResultset(const QSqlQuery& rs, int field_no) {
+        setFromValue(rs.value(field_no));
+    }
 };
 
 /** \Struct String
  * 
- * struct to handle TObjString branches 
+ * struct to handle TObjString branches. The struct owns a single
+ * TObjString which is booked as the branch object and overwritten for
+ * every row, so filling does not allocate a new object per row
  */
 struct String : public Base_Type {
     /**
-     * Default constructor. Initialize to 0
+     * Default constructor. Initialize to an empty string
      */
     String(): 
         Base_Type(), 
-        value(0) 
+        value(new TObjString()) 
     { 
     }
 
@@ -61,13 +72,23 @@ struct String : public Base_Type {
     }
 
     ~String() {
+        delete value;
     }
     
-    virtual void setFromResultset(const QSqlQuery& rs, int field_no) { 
-        value = new TObjString(Form("%s",rs.value(field_no).toString().toStdString().c_str() ) );
+    virtual void setFromValue(const QVariant& v) { 
+        value->SetString(v.toString().toLatin1().constData());
+    }
+
+    void set(const std::string& v) {
+        value->SetString(v.c_str());
     }
     
     TObjString* value;
+
+    private:
+        // the branch object is owned, so String must not be copied
+        String(const String&);
+        String& operator=(const String&);
 };
 
 /** \Struct Double
@@ -84,8 +105,8 @@ struct Double : public Base_Type {
     {
     }
     
-    virtual void setFromResultset(const QSqlQuery& rs, int field_no) { 
-        value = rs.value(field_no).toDouble();
+    virtual void setFromValue(const QVariant& v) { 
+        value = v.toDouble();
     }
     
     double value;
@@ -105,8 +126,8 @@ struct Integer : public Base_Type {
     {
     }
     
-    virtual void setFromResultset(const QSqlQuery& rs, int field_no) { 
-        value = rs.value(field_no).toInt();
+    virtual void setFromValue(const QVariant& v) { 
+        value = v.toInt();
     }
     
     unsigned int value;
@@ -121,6 +142,10 @@ struct Integer : public Base_Type {
 struct BaseQuery {
     
     QVector<std::pair<std::string, Base_Type* > > query;
+
+    ~BaseQuery() {
+        for (int i = 0; i < query.size(); i++) delete query[i].second;
+    }
     
     BaseQuery() {
         query.push_back(std::make_pair("Detector"       , new String() ) );
@@ -149,6 +174,13 @@ struct BaseQuery {
         query.push_back(std::make_pair("lasChan"        , new Double() ) );  
     }
     
+    /**
+     * run types for which #setExtendedQuery adds branches
+     */
+    static QStringList extendedTypes() {
+        return QStringList() << "TIMING" << "GAINSCAN" << "OPTOSCAN" << "VPSPSCAN" << "VERY_FAST_CONNECTION" << "FASTFEDCABLING" << "PEDESTALS" << "PEDESTAL" << "SCOPE" << "ENC_PEDESTAL";
+    }
+
     void setExtendedQuery(const std::string& runType) {
         if(runType == "TIMING") {
             query.push_back(std::make_pair("DeviceId"   , new Double() ) );
@@ -286,5 +318,96 @@ struct BaseQuery {
         } 
     }
 
+    private:
+        // the branch objects are owned and booked by address, so BaseQuery must not be copied
+        BaseQuery(const BaseQuery&);
+        BaseQuery& operator=(const BaseQuery&);
 };
+
+/** \Struct ColumnBuffer
+ *
+ * struct to hold a block of result rows column by column in typed
+ * contiguous buffers. The columns follow the branch layout of a
+ * BaseQuery, so that a row can be copied into the branches without
+ * going through the virtual Base_Type interface
+ */
+struct ColumnBuffer {
+
+    enum ColumnKind { DOUBLE, INTEGER, STRING };
+
+    std::vector<std::pair<ColumnKind, size_t> > fields; /**< kind of each field and its index among the columns of that kind */
+    std::vector<std::vector<double> >           doubles;
+    std::vector<std::vector<unsigned int> >     integers;
+    std::vector<std::vector<std::string> >      strings;
+    size_t rows;
+
+    ColumnBuffer():
+        rows(0)
+    {
+    }
+
+    /**
+     * set up one typed column per branch of the query
+     */
+    void setLayout(const BaseQuery& q) {
+        fields.clear();
+        doubles.clear();
+        integers.clear();
+        strings.clear();
+        rows = 0;
+        for (int i = 0; i < q.query.size(); i++) {
+            Base_Type* b = q.query[i].second;
+            if      (dynamic_cast<Double*> (b) != NULL) { fields.push_back(std::make_pair(DOUBLE,  doubles.size()));  doubles .push_back(std::vector<double>());       }
+            else if (dynamic_cast<Integer*>(b) != NULL) { fields.push_back(std::make_pair(INTEGER, integers.size())); integers.push_back(std::vector<unsigned int>()); }
+            else if (dynamic_cast<String*> (b) != NULL) { fields.push_back(std::make_pair(STRING,  strings.size()));  strings .push_back(std::vector<std::string>());  }
+        }
+    }
+
+    /**
+     * exchange the layout and rows with another buffer without copying
+     * the columns
+     */
+    void swap(ColumnBuffer& other) {
+        fields.swap(other.fields);
+        doubles.swap(other.doubles);
+        integers.swap(other.integers);
+        strings.swap(other.strings);
+        std::swap(rows, other.rows);
+    }
+
+    /**
+     * reserve space for a block of rows in every column
+     */
+    void reserve(size_t n) {
+        for (size_t c = 0; c < doubles.size();  c++) doubles[c] .reserve(n);
+        for (size_t c = 0; c < integers.size(); c++) integers[c].reserve(n);
+        for (size_t c = 0; c < strings.size();  c++) strings[c] .reserve(n);
+    }
+
+    /**
+     * drop the rows but keep the layout and the allocated buffers
+     */
+    void clear() {
+        for (size_t c = 0; c < doubles.size();  c++) doubles[c] .clear();
+        for (size_t c = 0; c < integers.size(); c++) integers[c].clear();
+        for (size_t c = 0; c < strings.size();  c++) strings[c] .clear();
+        rows = 0;
+    }
+
+    /**
+     * append the current row of a result set
+     */
+    void read(const QSqlQuery& rs) {
+        for (size_t i = 0; i < fields.size(); i++) {
+            const QVariant v = rs.value(i);
+            switch (fields[i].first) {
+                case DOUBLE  : doubles [fields[i].second].push_back(v.toDouble()); break;
+                case INTEGER : integers[fields[i].second].push_back(v.toInt());    break;
+                case STRING  : strings [fields[i].second].push_back(v.toString().toStdString()); break;
+            }
+        }
+        rows++;
+    }
+};
+
 #endif
@@ -49,16 +49,9 @@
 
 
 Chip::Chip()
-  : value_(0), detid_(0), napvs_(0), color_(Qt::gray), text(new TText), fixStatus_(0), run_(0), showTT_(false)
+  : value_(0), detid_(0), napvs_(0), text(new TText), fixStatus_(0), run_(0), showTT_(false), toolTipValid_(false), toolTipDetailed_(false), layer_(NULL)
 {
-
-}
-
-
-Chip::Chip(const QColor &color)
-  : value_(0), detid_(0), napvs_(0), color_(color), text(new TText), fixStatus_(0), run_(0), showTT_(false)
-{
-  //setFlags(ItemIsSelectable | ItemIsMovable);
+  setAcceptHoverEvents(true);
 }
 
 QRectF Chip::boundingRect() const
@@ -68,10 +61,7 @@ QRectF Chip::boundingRect() const
 
 QPainterPath Chip::shape() const
 {
-  QPainterPath path;
-  path.addPolygon(polygon_);
-  return path;
-  
+  return shape_;
 }
 void Chip::setShape(const QVector<QPointF> &points) 
 {
@@ -86,6 +76,9 @@ void Chip::setShape(const QVector<QPointF> &points)
   polygon_ = trans.map( polygon_ );
   polygon_.translate(point);
 
+  shape_ = QPainterPath();
+  shape_.addPolygon(polygon_);
+
   if( detid_ != 0 ) constructApvs();
 }
 
@@ -120,13 +113,29 @@ void Chip::constructApvs()
     QPolygonF apv;
     apv << base.p1() << base.p2() << slope.p2() << slope.p1() << base.p1();
     apvs_.insert(i2c,apv);
-    apvColors_.insert(i2c,QColor(Qt::white));
     base.translate(base.dx(),base.dy());
     slope.translate(slope.dx(),slope.dy());
   }	
 
 }
 
+void Chip::clearValues()
+{
+  setSelected(false);
+  setFlags(0);
+  value_ = 0;
+  apvValues_.clear();
+  apvStripNoiseValues_.clear();
+  apvStripPedsValues_.clear();
+  apvFecKeys_.clear();
+  apvFedKeys_.clear();
+  showTT_ = false;
+  setToolTip(QString());
+  toolTipValid_ = false;
+  valuesChanged();
+  update();
+}
+
 void Chip::setAPVStripNoiseValues(int i2caddress, double *value )
 {
   std::vector<double> tmp; tmp.resize(128); 
@@ -141,6 +150,66 @@ void Chip::setAPVStripPedsValues(int i2caddress, double *value )
   apvStripPedsValues_.insert(i2caddress,tmp);
 }
 
+void Chip::updateToolTip(bool detailed)
+{
+  if( toolTipValid_ && toolTipDetailed_ == detailed ) return;
+
+  QString tip = QString("<table>")+
+    QString("<tr><td>Detid: </td><td>")+QString::number(detid_)+QString("</td></tr>")+
+    QString("<tr><td>value: </td><td>")+QString::number(value_)+QString("</td</tr>");
+
+  // if we are zoomed in, also include information about the APVs
+  // (those without a value are listed with 0)
+  if( detailed ) {
+    tip += QString("<tr><td>I2CAddress</td><td>Values</td></tr>");
+
+    QMap<int, double> values = apvValues_;
+    for( QMap<int, QPolygonF>::const_iterator it = apvs_.constBegin(); it != apvs_.constEnd(); ++it ) {
+      if( !values.contains(it.key()) ) values.insert(it.key(), 0.0);
+    }
+    for( QMap<int, double>::const_iterator it = values.constBegin(); it != values.constEnd(); ++it ) {
+      tip += QString("<tr><td>")+QString::number(it.key()%31)+QString("</td><td>")+QString::number(it.value())+QString("</td</tr>");
+    }
+  }
+  tip += QString("</table>");
+
+  setToolTip(tip);
+  toolTipValid_ = true;
+  toolTipDetailed_ = detailed;
+}
+
+void Chip::hoverEnterEvent(QGraphicsSceneHoverEvent *event)
+{
+  // add a tool tip, i.e. mouseover information for this module, with
+  // the same level of detail as the view currently paints
+  if( showTT_ ) {
+    QGraphicsView* view = event->widget() ? qobject_cast<QGraphicsView*>(event->widget()->parentWidget()) : NULL;
+    qreal lod = view ? QStyleOptionGraphicsItem::levelOfDetailFromTransform(view->transform()) : 0;
+    updateToolTip( lod >= 3 );
+  }
+  QGraphicsItem::hoverEnterEvent(event);
+}
+
+void Chip::valuesChanged()
+{
+  if( layer_ ) layer_->invalidate();
+}
+
+void Chip::updateContents()
+{
+  const bool noContents = layer_ && layer_->collapsed() && !isSelected() && !fixStatus_;
+  if( noContents == bool(flags() & ItemHasNoContents) ) return;
+  setFlag(ItemHasNoContents, noContents);
+  // the scene skips items without contents, the area is repainted from the layer image
+  if( scene() ) scene()->update(sceneBoundingRect());
+}
+
+QVariant Chip::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+  if( change == ItemSelectedHasChanged ) updateContents();
+  return QGraphicsItem::itemChange(change, value);
+}
+
 void Chip::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
   Q_UNUSED(widget);
@@ -148,32 +217,25 @@ void Chip::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
   // this is the real magic of this class: get the 'level of detail'
   // from the QPainter that is responsible for drawing these objects
   // this level corresponds basically to the zoom level and hence we
-  // can use this information to decide what we want to show (APVs or
-  // not)
+  // can use this information to decide what we want to show (layer
+  // image, module or APVs)
   const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+  const bool selected = (option->state & QStyle::State_Selected);
 
-  painter->save();
+  // when zoomed out the module is part of the image of its layer, only
+  // selected and fixed modules are drawn on top of it
+  if( layer_ && detailTier(lod) == LAYER_TIER && !selected && !fixStatus_ ) return;
 
-  // add a tool tip, i.e. mouseover information for this module
-  if (showTT_) {  
-    this->setToolTip(QString("<table>")+
-      	   QString("<tr><td>Detid: </td><td>")+QString::number(detid_)+QString("</td></tr>")+
-      	   QString("<tr><td>value: </td><td>")+QString::number(value_)+QString("</td</tr>"));
-    
-    // if we are zoomed in, also include information about the APVs
-    if( lod >= 3 ) {
-      this->setToolTip(this->toolTip()+QString("<tr><td>I2CAddress</td><td>Values</td></tr>"));
-    
-      QMap<int, double>::iterator it = apvValues_.begin();
-      for( ; it != apvValues_.end(); ++it ) {
-        this->setToolTip(this->toolTip()+QString("<tr><td>")+QString::number(it.key()%31)+QString("</td><td>")+QString::number(it.value())+QString("</td</tr>"));
-      }
-    }
-    this->setToolTip(this->toolTip()+QString("</table>"));
-  }  
+  draw(painter, lod, selected);
+}
+
+void Chip::draw(QPainter *painter, qreal lod, bool selected)
+{
+  const int tier = detailTier(lod);
+
+  painter->save();
 
-  Float_t r=100,g=100,b=100;
-  getColor(value_,r,g,b);
+  QColor color = M::m()->color(value_);
 
   // set pen size depending on zoom-level so that we don't draw too
   // thick lines
@@ -188,34 +250,32 @@ void Chip::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
   // change outline of the module depending if it is selected and/or
   // fixed
-  if ( (option->state & QStyle::State_Selected) ) {
+  if ( selected ) {
     newPen.setColor( QColor(Qt::red) );
     newPen.setWidthF(1.5);
   } else {
     if( fixStatus_ ) { 
       newPen.setWidthF(1.5);
       newPen.setColor(QColor(Qt::blue));
-    } else if(  lod < 0.55 && !( value_ < 1e-6 && value_ > -1e-6 ) ) {
-      newPen.setColor(QColor::fromRgbF(r,g,b));
+    } else if( tier == LAYER_TIER && !( value_ < 1e-6 && value_ > -1e-6 ) ) {
+      newPen.setColor(color);
     } else {
       newPen.setColor(QColor(Qt::black));
     }
   }
 
   // if we are zoomed in, we paint the APV objects
-  if (lod >= 3) {
+  if( tier == APV_TIER ) {
     painter->setPen(QPen(Qt::black,0));
-    QMap<int, QPolygonF>::iterator it = apvs_.begin();
-    for( ; it != apvs_.end(); ++it ) {
-      r=100;g=100;b=100;
-      getColor(apvValues_[it.key()],r,g,b);
-      painter->setBrush(QColor::fromRgbF(r,g,b));
+    QMap<int, QPolygonF>::const_iterator it = apvs_.constBegin();
+    for( ; it != apvs_.constEnd(); ++it ) {
+      painter->setBrush(M::m()->color(apvValues_.value(it.key())));
       painter->drawPolygon(it.value());
     }
   }
 
   painter->setPen(newPen);
-  painter->setBrush(QBrush(QColor::fromRgbF(r,g,b), lod >= 3 ? Qt::NoBrush : Qt::SolidPattern  ) );
+  painter->setBrush(QBrush(color, tier == APV_TIER ? Qt::NoBrush : Qt::SolidPattern  ) );
   painter->drawPolygon(polygon_);
   painter->restore();  
 
@@ -363,3 +423,63 @@ void Chip::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
   QGraphicsItem::mouseReleaseEvent(event);
   update();
 }
+
+
+ChipLayer::ChipLayer()
+  : pixmapLod_(0), colorVersion_(0), valid_(false), collapsed_(false)
+{
+  setZValue(-1);
+  setAcceptedMouseButtons(0);
+}
+
+void ChipLayer::addChip(Chip* chip)
+{
+  chips_.append(chip);
+  rect_ = rect_.isNull() ? chip->boundingRect() : rect_.united(chip->boundingRect());
+  chip->setLayer(this);
+  valid_ = false;
+}
+
+void ChipLayer::setCollapsed(bool collapsed)
+{
+  if( collapsed == collapsed_ ) return;
+  collapsed_ = collapsed;
+  for( int i = 0; i < chips_.size(); ++i ) chips_[i]->updateContents();
+}
+
+void ChipLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  Q_UNUSED(widget);
+
+  const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+  if( detailTier(lod) != LAYER_TIER || chips_.isEmpty() ) return;
+
+  // render again if the image would be scaled by more than 25%
+  if( !valid_ || colorVersion_ != M::m()->colorVersion() || 
+      pixmapLod_ <= 0 || lod / pixmapLod_ > 1.25 || lod / pixmapLod_ < 0.8 ) render(lod);
+
+  painter->drawPixmap(rect_, pixmap_, QRectF(pixmap_.rect()));
+}
+
+void ChipLayer::render(qreal lod)
+{
+  // keep the image within a sane size, whatever the zoom
+  static const int maxSize = 2048;
+  qreal scale = lod;
+  if( rect_.width()  * scale > maxSize ) scale = maxSize / rect_.width();
+  if( rect_.height() * scale > maxSize ) scale = maxSize / rect_.height();
+
+  QSize size(qMax(1, qRound(rect_.width() * scale)), qMax(1, qRound(rect_.height() * scale)));
+  if( pixmap_.size() != size ) pixmap_ = QPixmap(size);
+  pixmap_.fill(Qt::transparent);
+
+  QPainter painter(&pixmap_);
+  painter.scale(size.width() / rect_.width(), size.height() / rect_.height());
+  painter.translate(-rect_.topLeft());
+  for( int i = 0; i < chips_.size(); ++i ) chips_[i]->draw(&painter, lod, false);
+  painter.end();
+
+  pixmapLod_    = lod;
+  colorVersion_ = M::m()->colorVersion();
+  valid_        = true;
+}
@@ -7,8 +7,11 @@
 #include <TQtWidget.h>
 #include <QtGui/QColor>
 #include <QtGui/QGraphicsItem>
+#include <QtGui/QPixmap>
 #include <TText.h>
 
+class ChipLayer;
+
 /** \Class Chip
  * \brief Class representing a single strip tracker module within the tracker map
  *
@@ -21,10 +24,6 @@ class Chip : public QGraphicsItem {
      * default constructor
      */ 
     Chip();
-    /**
-     * constructor passing a QColor object
-     */ 
-    Chip(const QColor &color);
     
     /**
      * return the bounding rectangle of this object
@@ -34,10 +33,29 @@ class Chip : public QGraphicsItem {
      * return a QPainterPath with the polygon of this object
      */
     QPainterPath  shape() const;
+    /**
+     * return true if the polygon of this object intersects rect
+     */
+    bool          intersects(const QRectF& rect) const { return shape_.intersects(rect); }
     /**
      * paint method to determine how this object should appear
      */
     void          paint(QPainter *painter, const QStyleOptionGraphicsItem *item, QWidget *widget);
+    /**
+     * draw this object for the given level of detail, used by #paint
+     * and to render the cached image of the #ChipLayer
+     */
+    void          draw(QPainter *painter, qreal lod, bool selected);
+    /**
+     * set the layer whose cached image shows this object when zoomed out
+     */
+    void          setLayer(ChipLayer* layer) { layer_ = layer; }
+    /**
+     * tell the scene whether this object has to be painted, it is left
+     * out while the image of its collapsed layer shows it, unless it is
+     * selected or fixed
+     */
+    void          updateContents();
     /**
      * set points 
      * @param points QVector of QPointF objects
@@ -46,15 +64,15 @@ class Chip : public QGraphicsItem {
     /**
      * set global value associated with this object
      */
-    void          setValue(double value) { value_ = value;   setFlags(ItemIsSelectable ); }
+    void          setValue(double value) { value_ = value;   setFlags(ItemIsSelectable ); toolTipValid_ = false; valuesChanged(); }
     /**
-     * set QColor object in this class
-     */ 
-    void          setColor(QColor color) { color_ = color; }
+     * drop the global and APV values, the object is no longer mapped
+     */
+    void          clearValues();
     /**
      * method set the value for a given APV of this object
      */
-    void          setAPVValue(int i2caddress, double value) { apvValues_.insert(i2caddress,value); }
+    void          setAPVValue(int i2caddress, double value) { apvValues_.insert(i2caddress,value); toolTipValid_ = false; valuesChanged(); }
     /**
      * set strip noise values for a given APV of this object
      */
@@ -71,14 +89,10 @@ class Chip : public QGraphicsItem {
      * set SiStripFedKey for a given APV of this object
      */
     void          setAPVFedKey(int i2caddress, unsigned key ) { apvFedKeys_.insert(i2caddress, key); }
-    /**
-     * set QColor object for a given APV of this object
-     */
-    void          setAPVColor(int i2caddress, QColor color) { apvColors_.insert(i2caddress,color); }
     /**
      * set detid of this object, derive number of APVs on this type of module using #nAPV method
      */
-    void          setDetid(unsigned long detid) { detid_ = detid;  napvs_ = nAPV(detid_); if( points_.size() > 0 ) constructApvs(); }
+    void          setDetid(unsigned long detid) { detid_ = detid;  napvs_ = nAPV(detid_); if( points_.size() > 0 ) constructApvs(); toolTipValid_ = false; }
     /**
      * get global value for this object
      */
@@ -92,13 +106,14 @@ class Chip : public QGraphicsItem {
      */ 
     void          setRunNumber( int r ) { run_ = r; }
     /**
-     * set flag for tool tip text
+     * set flag for tool tip text. The text itself is built when the
+     * mouse enters the object
      */ 
     void          showToolTip( bool f ) { showTT_ = f; }
     /**
      * set fix status of this object
      */ 
-    void          setFixStatus( bool rhs ) { fixStatus_ = rhs; }
+    void          setFixStatus( bool rhs ) { fixStatus_ = rhs; updateContents(); }
     /**
      * get fix status of this object
      */ 
@@ -133,6 +148,11 @@ class Chip : public QGraphicsItem {
      * this method only forwards the event to the base class
      */ 
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event);
+    /**
+     * overload of QGraphicsItem::hoverEnterEvent
+     * brings the tool tip up to date before it is shown
+     */ 
+    void hoverEnterEvent(QGraphicsSceneHoverEvent *event);
 
     private:
     /**
@@ -143,27 +163,95 @@ class Chip : public QGraphicsItem {
      * draw values for a given container onto a TQtWidget
      */
     void drawValues( TQtWidget *widget, int &pad, QMap<int, std::vector<double> >::iterator &it, double &min, double &max, TString value );
+    /**
+     * build the tool tip text, unless the cached text is still valid.
+     * The APV values are only listed in the detailed version
+     */
+    void updateToolTip( bool detailed );
+    /**
+     * invalidate the cached image of the layer of this object
+     */
+    void valuesChanged();
+    /**
+     * keep the contents flag up to date when the selection changes
+     */
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
 
     // members
     double                         value_;                /*!< a value associated with this object used to determine its color */
     unsigned long                  detid_;                /*!< detid to uniquely identify this object */
     int                            napvs_;                /*!< the number of APVs associated with this object */
-    QColor                         color_;                /*!< a QColor object to steer the current color of the object */
     QPolygonF                      polygon_;              /*!< a QPolygonF that contains the outline of the module */
     QRectF                         rect_;                 /*!< the bounding rectangle of this object */                             
+    QPainterPath                   shape_;                /*!< the polygon of this object as path, for hit tests */
     QVector<QPointF>               points_;               /*!< QVector of points associated with this object */                             
     QMap<int, QPolygonF>           apvs_;                 /*!< Map of polygons for the individual APVs */                             
     QMap<int, double>               apvValues_;           /*!< Map of values for the individual APVs */
     QMap<int, std::vector<double> > apvStripNoiseValues_; /*!< Map of strip noise values for the individual APVs */                             
     QMap<int, std::vector<double> > apvStripPedsValues_;  /*!< Map of strip pedestal values for the individual APVs */                             
-    QMap<int, QColor>              apvColors_;            /*!< Map of QColor objects for the individual APVs */                             
     QMap<int, unsigned>            apvFecKeys_;           /*!< Map of SiStripFecKey for the individual APVs */                             
     QMap<int, unsigned>            apvFedKeys_;           /*!< Map of SiStripFedKey for the individual APVs */                             
     TText*                         text;                  /*!< TText object to draw various text elements */ 
     bool                           fixStatus_;            /*!< record fix status of this object */ 
     int                            run_;                  /*!< run number */    
     bool                           showTT_;               /*!< Flag for tool tip text */
+    bool                           toolTipValid_;         /*!< false when the tool tip text needs to be rebuilt */
+    bool                           toolTipDetailed_;      /*!< tool tip text includes the APV values */
+    ChipLayer*                     layer_;                /*!< layer drawing this object when zoomed out, not owned */
     
 };
 
+/** \Class ChipLayer
+ * \brief Item drawing all modules of one layer of the tracker map from
+ * a cached image when the map is zoomed out
+ *
+ * At the #LAYER_TIER level of detail the #Chip objects of the layer do
+ * not paint themselves, unless they are selected or fixed. The image is
+ * rendered again when the level of detail changes noticeably, when the
+ * color scale changes or when a value of one of the modules changes.
+ * While the layer is collapsed, its modules are flagged as having no
+ * contents so that the scene does not even prepare their painting. They
+ * are not hidden, since hidden items could not be selected or hovered
+ */
+class ChipLayer : public QGraphicsItem {
+    public:
+    ChipLayer();
+    /**
+     * add a module to this layer, before the layer is added to the scene
+     */
+    void          addChip(Chip* chip);
+    /**
+     * return the bounding rectangle of all modules of this layer
+     */
+    QRectF        boundingRect() const { return rect_; }
+    /**
+     * paint the cached image, if zoomed out
+     */
+    void          paint(QPainter *painter, const QStyleOptionGraphicsItem *item, QWidget *widget);
+    /**
+     * mark the cached image as out of date
+     */
+    void          invalidate() { valid_ = false; }
+    /**
+     * let the cached image show the modules, to be set when the view
+     * is zoomed out to the #LAYER_TIER
+     */
+    void          setCollapsed(bool collapsed);
+    bool          collapsed() const { return collapsed_; }
+
+    private:
+    /**
+     * render the image of the layer at the given level of detail
+     */
+    void          render(qreal lod);
+
+    QList<Chip*>                   chips_;                /*!< modules of this layer, owned by the scene */
+    QRectF                         rect_;                 /*!< the bounding rectangle of all modules */
+    QPixmap                        pixmap_;               /*!< cached image of the layer */
+    qreal                          pixmapLod_;            /*!< level of detail the image was rendered for */
+    unsigned                       colorVersion_;         /*!< color scale version the image was rendered with */
+    bool                           valid_;                /*!< false when the image needs to be rendered again */
+    bool                           collapsed_;            /*!< true when the image shows the modules */
+};
+
 #endif
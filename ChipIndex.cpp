@@ -0,0 +1,141 @@
+#include "ChipIndex.h"
+#include "Chip.h"
+
+#include <QPair>
+#include <QtAlgorithms>
+#include <cmath>
+
+namespace {
+    struct Entry {
+        QRectF rect;
+        Chip*  chip;
+    };
+
+    template <class T>
+    bool xLessThan(const T& a, const T& b) { return a.rect.center().x() < b.rect.center().x(); }
+    template <class T>
+    bool yLessThan(const T& a, const T& b) { return a.rect.center().y() < b.rect.center().y(); }
+
+    // sort-tile-recursive order: vertical slices sorted by x, each of
+    // them sorted by y, so that runs of nodeSize items are compact tiles
+    template <class T>
+    void tileSort(QVector<T>& items, int nodeSize) {
+        int nGroups = (items.size() + nodeSize - 1) / nodeSize;
+        int nSlices = int(std::ceil(std::sqrt(double(nGroups))));
+        int sliceSize = nSlices * nodeSize;
+
+        qSort(items.begin(), items.end(), xLessThan<T>);
+        for (int i = 0; i < items.size(); i += sliceSize) {
+            int end = qMin(i + sliceSize, items.size());
+            qSort(items.begin() + i, items.begin() + end, yLessThan<T>);
+        }
+    }
+}
+
+void ChipIndex::clear() {
+    entries_.clear();
+    rects_.clear();
+    levels_.clear();
+}
+
+void ChipIndex::build(const QVector<Chip*>& chips) {
+    clear();
+    if (chips.isEmpty()) return;
+
+    QVector<Entry> entries(chips.size());
+    for (int i = 0; i < chips.size(); i++) {
+        entries[i].rect = chips[i]->boundingRect();
+        entries[i].chip = chips[i];
+    }
+    tileSort(entries, nodeSize);
+
+    entries_.resize(entries.size());
+    rects_.resize(entries.size());
+    QVector<Node> leaves;
+    for (int i = 0; i < entries.size(); i++) {
+        entries_[i] = entries[i].chip;
+        rects_[i]   = entries[i].rect;
+        if (i % nodeSize == 0) {
+            Node node;
+            node.rect  = entries[i].rect;
+            node.first = i;
+            node.count = 0;
+            leaves.push_back(node);
+        }
+        Node& leaf = leaves.last();
+        leaf.rect = leaf.rect.united(entries[i].rect);
+        leaf.count++;
+    }
+    levels_.push_back(leaves);
+
+    while (levels_.last().size() > 1) {
+        QVector<Node> parents;
+        pack(levels_.last(), parents);
+        levels_.push_back(parents);
+    }
+}
+
+void ChipIndex::pack(QVector<Node>& nodes, QVector<Node>& parents) const {
+    // the children ranges refer to the level below, so the nodes of this
+    // level can be reordered freely
+    tileSort(nodes, nodeSize);
+    for (int i = 0; i < nodes.size(); i++) {
+        if (i % nodeSize == 0) {
+            Node node;
+            node.rect  = nodes[i].rect;
+            node.first = i;
+            node.count = 0;
+            parents.push_back(node);
+        }
+        Node& parent = parents.last();
+        parent.rect = parent.rect.united(nodes[i].rect);
+        parent.count++;
+    }
+}
+
+void ChipIndex::query(const QRectF& rect, QVector<Chip*>& result) const {
+    if (levels_.isEmpty()) return;
+
+    QVector<QPair<int, int> > stack; // (level, node)
+    stack.push_back(qMakePair(levels_.size() - 1, 0));
+    while (!stack.isEmpty()) {
+        QPair<int, int> top = stack.last();
+        stack.pop_back();
+
+        const Node& node = levels_[top.first][top.second];
+        if (!node.rect.intersects(rect)) continue;
+
+        if (top.first == 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                if (rects_[i].intersects(rect) && entries_[i]->intersects(rect)) result.push_back(entries_[i]);
+            }
+        }
+        else {
+            for (int i = node.first; i < node.first + node.count; i++) stack.push_back(qMakePair(top.first - 1, i));
+        }
+    }
+}
+
+Chip* ChipIndex::chipAt(const QPointF& point) const {
+    if (levels_.isEmpty()) return NULL;
+
+    QVector<QPair<int, int> > stack; // (level, node)
+    stack.push_back(qMakePair(levels_.size() - 1, 0));
+    while (!stack.isEmpty()) {
+        QPair<int, int> top = stack.last();
+        stack.pop_back();
+
+        const Node& node = levels_[top.first][top.second];
+        if (!node.rect.contains(point)) continue;
+
+        if (top.first == 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                if (rects_[i].contains(point) && entries_[i]->contains(point)) return entries_[i];
+            }
+        }
+        else {
+            for (int i = node.first; i < node.first + node.count; i++) stack.push_back(qMakePair(top.first - 1, i));
+        }
+    }
+    return NULL;
+}
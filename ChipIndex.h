@@ -0,0 +1,64 @@
+#ifndef CHIPINDEX_H
+#define CHIPINDEX_H
+
+#include <QRectF>
+#include <QPointF>
+#include <QVector>
+
+class Chip;
+
+/** \Class ChipIndex
+ *
+ * \brief Static spatial index over the modules of the tracker map
+ *
+ * A packed R-tree, bulk loaded with the sort-tile-recursive method from
+ * the bounding rectangles of the #Chip objects once the geometry is
+ * loaded. Since the layout never changes afterwards, the tree is built
+ * once and never updated. It answers the rectangle queries of the
+ * rubber band selection and the point queries of the view without going
+ * through the index of the QGraphicsScene.
+ */
+class ChipIndex {
+    public:
+        static const int nodeSize = 16; /**< maximum number of children of a node */
+
+        ChipIndex() {}
+
+        /**
+         * build the tree. The objects are owned by the scene and need to
+         * outlive the index
+         */
+        void build(const QVector<Chip*>& chips);
+
+        /**
+         * drop all entries
+         */
+        void clear();
+
+        /**
+         * append to result all objects whose shape intersects rect
+         */
+        void query(const QRectF& rect, QVector<Chip*>& result) const;
+
+        /**
+         * return the object whose shape contains point, NULL if there is none
+         */
+        Chip* chipAt(const QPointF& point) const;
+
+        int size() const { return entries_.size(); }
+
+    private:
+        struct Node {
+            QRectF rect;  // bounding rectangle of the children
+            int    first; // index of the first child in the level below, or in entries_ for leaves
+            int    count; // number of children
+        };
+
+        void pack(QVector<Node>& nodes, QVector<Node>& parents) const;
+
+        QVector<Chip*>          entries_; // objects, in leaf order
+        QVector<QRectF>         rects_;   // bounding rectangles of the objects
+        QVector<QVector<Node> > levels_;  // levels_[0] are the leaves, the last level is the root
+};
+
+#endif
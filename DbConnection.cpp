@@ -1,4 +1,14 @@
 #include "DbConnection.h"
+#include "DbQueryExecutor.h"
 
 DbConnection* DbConnection::pInstance = 0;
 
+DbQueryExecutor* DbConnection::executor() {
+    if (executor_ == 0) executor_ = new DbQueryExecutor(dbConnection_, poolSize, "Pool");
+    return executor_;
+}
+
+void DbConnection::stopExecutor() {
+    delete executor_;
+    executor_ = 0;
+}
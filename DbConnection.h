@@ -10,6 +10,11 @@
 // C++ string implementation
 #include <string>
 
+// Qt includes
+#include <QString>
+
+class DbQueryExecutor;
+
 /** \Class DbConnection
  *
  * \brief Singleton class to facilitate access to an oracle database
@@ -19,6 +24,7 @@ class DbConnection {
         static DbConnection* pInstance;
         QSqlDatabase dbConnection_;
         bool dbConnected_;
+        DbQueryExecutor* executor_;
 
     protected:
         /**
@@ -26,11 +32,14 @@ class DbConnection {
          */
         DbConnection():
             dbConnection_(QSqlDatabase::addDatabase("QOCI")), 
-            dbConnected_(false)
+            dbConnected_(false),
+            executor_(0)
         { 
         }
 
     public:
+        static const int poolSize = 4; /**< number of sessions of the query executor */
+
         /**
          * return static instance of this class
          */
@@ -66,6 +75,8 @@ class DbConnection {
             dbConnection_.setDatabaseName(dbPath.c_str());
             dbConnection_.setUserName(login.c_str());
             dbConnection_.setPassword(passwd.c_str());
+            // let OCI retrieve rows in blocks rather than one round trip per row
+            if (dbConnection_.driverName() == "QOCI") dbConnection_.setConnectOptions("OCI_ATTR_PREFETCH_ROWS=5000");
             dbConnected_ = dbConnection_.open();
             return true;
         }
@@ -78,6 +89,54 @@ class DbConnection {
             return dbConnection_;
         } 
 
+        /**
+         * open an additional session on the database with the same
+         * driver and credentials as the main connection. A QSqlDatabase
+         * may only be used from the thread which opened it, so every
+         * worker thread has to open its own named session
+         */
+        QSqlDatabase openSession(const QString& name) {
+            return openSession(name, dbConnection_);
+        }
+
+        /**
+         * open a session with the driver and credentials of the given
+         * connection, which may use any driver
+         */
+        QSqlDatabase openSession(const QString& name, const QSqlDatabase& source) {
+            QSqlDatabase session = QSqlDatabase::cloneDatabase(source, name);
+            if (!session.open()) {
+                if (Debug::Inst()->getEnabled()) qDebug() << "could not open DB session " << qPrintable(name);
+            }
+            return session;
+        }
+
+        /**
+         * close and remove a session opened with openSession. All
+         * QSqlDatabase and QSqlQuery objects using the session have to
+         * be out of scope before calling this
+         */
+        void closeSession(const QString& name) {
+            {
+                QSqlDatabase session = QSqlDatabase::database(name, false);
+                if (session.isOpen()) session.close();
+            }
+            QSqlDatabase::removeDatabase(name);
+        }
+
+        /**
+         * return the executor running queries on a pool of #poolSize
+         * sessions of the main connection, created on first use
+         */
+        DbQueryExecutor* executor();
+
+        /**
+         * stop the executor and close its sessions. Waits for the
+         * queries which are running, to be called once the event loop
+         * is over and before the QApplication is destroyed
+         */
+        void stopExecutor();
+
         /**
          * return status of database connection
          */
@@ -0,0 +1,114 @@
+#include "DbQueryExecutor.h"
+#include "DbConnection.h"
+#include "Debug.h"
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QTime>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+
+/** \Class DbSessionWorker
+ *
+ * Worker thread of the #DbQueryExecutor, owning one database session
+ */
+class DbSessionWorker : public QThread {
+    public:
+        DbSessionWorker(DbQueryExecutor* executor, const QSqlDatabase& source, const QString& sessionName):
+            QThread(),
+            executor_(executor),
+            source_(source),
+            sessionName_(sessionName)
+        {
+        }
+
+    protected:
+        void run() {
+            {
+                QSqlDatabase db = DbConnection::Inst()->openSession(sessionName_, source_);
+                DbQueryExecutor::Job job;
+                while (executor_->takeJob(job)) {
+                    DbQueryResult result;
+                    result.ticket = job.ticket;
+                    if (!db.isOpen()) {
+                        result.error = QString("Session %1 is not open").arg(sessionName_);
+                        emit executor_->finished(result);
+                        continue;
+                    }
+
+                    QTime timer;
+                    timer.start();
+                    QSqlQuery query(db);
+                    query.setForwardOnly(true);
+                    result.ok = query.prepare(job.query);
+                    for (int i = 0; result.ok && i < job.bindValues.size(); i++) query.addBindValue(job.bindValues[i]);
+                    if (result.ok) result.ok = query.exec();
+                    if (result.ok) {
+                        while (query.next()) result.rows.push_back(query.record());
+                    }
+                    else {
+                        result.error = query.lastError().text();
+                        if (Debug::Inst()->getEnabled()) qDebug() << "Query failed on session " << qPrintable(sessionName_) << ": " << qPrintable(result.error);
+                    }
+                    result.elapsedMs = timer.elapsed();
+                    emit executor_->finished(result);
+                }
+            }
+            DbConnection::Inst()->closeSession(sessionName_);
+        }
+
+    private:
+        DbQueryExecutor* executor_;
+        QSqlDatabase     source_;
+        QString          sessionName_;
+};
+
+DbQueryExecutor::DbQueryExecutor(const QSqlDatabase& source, int nSessions, const QString& prefix, QObject* parent):
+    QObject(parent),
+    nextTicket_(0),
+    stopping_(false)
+{
+    qRegisterMetaType<DbQueryResult>("DbQueryResult");
+
+    for (int i = 0; i < nSessions; i++) {
+        workers_.push_back(new DbSessionWorker(this, source, QString("%1_%2").arg(prefix).arg(i)));
+        workers_.back()->start();
+    }
+}
+
+DbQueryExecutor::~DbQueryExecutor() {
+    {
+        QMutexLocker lock(&mutex_);
+        stopping_ = true;
+        jobs_.clear();
+        jobAvailable_.wakeAll();
+    }
+    for (int i = 0; i < workers_.size(); i++) {
+        workers_[i]->wait();
+        delete workers_[i];
+    }
+}
+
+int DbQueryExecutor::submit(const QString& query, const QVariantList& bindValues) {
+    QMutexLocker lock(&mutex_);
+    Job job;
+    job.ticket     = nextTicket_++;
+    job.query      = query;
+    job.bindValues = bindValues;
+    jobs_.enqueue(job);
+    jobAvailable_.wakeOne();
+    return job.ticket;
+}
+
+int DbQueryExecutor::nPending() {
+    QMutexLocker lock(&mutex_);
+    return jobs_.size();
+}
+
+bool DbQueryExecutor::takeJob(Job& job) {
+    QMutexLocker lock(&mutex_);
+    while (jobs_.isEmpty() && !stopping_) jobAvailable_.wait(&mutex_);
+    if (stopping_) return false;
+    job = jobs_.dequeue();
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef DBQUERYEXECUTOR_H
+#define DBQUERYEXECUTOR_H
+
+// Qt includes
+#include <QObject>
+#include <QMetaType>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlRecord>
+
+class DbSessionWorker;
+
+/** \Class DbQueryResult
+ *
+ * \brief Outcome of a query run by the #DbQueryExecutor
+ */
+struct DbQueryResult {
+    int               ticket;  /**< number returned by DbQueryExecutor::submit */
+    bool              ok;      /**< false if the query could not be prepared or executed */
+    QString           error;   /**< database error text if the query failed */
+    QList<QSqlRecord> rows;    /**< result rows, empty for statements without result set */
+    int               elapsedMs; /**< time spent running the query and reading its rows */
+
+    DbQueryResult():
+        ticket(-1),
+        ok(false),
+        elapsedMs(0)
+    {
+    }
+};
+
+Q_DECLARE_METATYPE(DbQueryResult)
+
+/** \Class DbQueryExecutor
+ *
+ * \brief Pool of named database sessions running queries on worker threads
+ *
+ * Each of the N worker threads opens its own session, cloned from a
+ * given connection and named prefix_0 ... prefix_N-1, since a
+ * QSqlDatabase may only be used from the thread which opened it. Queries
+ * are queued by #submit and picked up by the first idle worker, so up to
+ * N of them run at the same time. The result is delivered by the
+ * #finished signal, which reaches receivers living in the GUI thread
+ * through a queued connection. Any Qt SQL driver can be used, the pool
+ * does not depend on the QOCI driver of the main connection.
+ */
+class DbQueryExecutor : public QObject {
+
+    Q_OBJECT
+
+    friend class DbSessionWorker;
+
+    public:
+        /**
+         * start nSessions workers, each with a session cloned from source
+         */
+        DbQueryExecutor(const QSqlDatabase& source, int nSessions, const QString& prefix, QObject* parent = 0);
+        /**
+         * drop the queries which have not started yet, wait for the
+         * running ones and close all sessions
+         */
+        ~DbQueryExecutor();
+
+        /**
+         * queue a query, the bind values are applied in order to its
+         * placeholders. Returns the ticket identifying the result
+         */
+        int submit(const QString& query, const QVariantList& bindValues = QVariantList());
+
+        /**
+         * number of sessions, i.e. of queries which can run at the same time
+         */
+        int nSessions() const { return workers_.size(); }
+
+        /**
+         * number of queries waiting for an idle session
+         */
+        int nPending();
+
+    signals:
+        /**
+         * emitted from the worker thread once a query is done
+         */
+        void finished(const DbQueryResult& result);
+
+    private:
+        struct Job {
+            int          ticket;
+            QString      query;
+            QVariantList bindValues;
+        };
+
+        /**
+         * wait for the next job, returns false once the executor stops
+         */
+        bool takeJob(Job& job);
+
+        QVector<DbSessionWorker*> workers_;
+        QQueue<Job>               jobs_;
+        QMutex                    mutex_;
+        QWaitCondition            jobAvailable_;
+        int                       nextTicket_;
+        bool                      stopping_;
+};
+
+#endif
@@ -2,8 +2,86 @@
 #include <sstream>
 #include <iostream>
 
+fedview::FedItem::FedItem(const QRectF& rect, const FED& fed, unsigned slot):
+    QGraphicsRectItem(rect),
+    fedMarked_(fed.isMarked)
+{
+    for (int j = 0; j < 8; j++) {
+        unitMarked_[j] = fed.units[j].isMarked;
+        channelMarked_[j] = 0;
+        for (int k = 0; k < 12; k++) if (fed.units[j].channels[k].isMarked) channelMarked_[j] |= (1 << k);
+    }
+
+    QPen redpen(Qt::red);
+    QPen graypen(Qt::gray);
+    redpen.setWidth(2);
+    setPen(fedMarked_ ? redpen : graypen);
+    setBrush(QBrush(Qt::gray));
+    setFlag(QGraphicsItem::ItemIsSelectable, true);
+    setAcceptHoverEvents(true);
+    setData(0, QString::number(fed.id));
+
+    std::stringstream tooltipss;
+    tooltipss << "FED ID : " << fed.id << std::endl;
+    tooltipss << "SLOT : " << slot << std::endl;
+    fedToolTip_ = tooltipss.str().c_str();
+    setToolTip(fedToolTip_);
+}
+
+QRectF fedview::FedItem::unitRect(int unit) const {
+    return QRectF(rect().x()+1., rect().y() + (-2*unit+15)*rect().height()/16., 8., 8.);
+}
+
+QRectF fedview::FedItem::channelRect(int unit, int chan) const {
+    return QRectF(rect().x()+2.8+2.5*(2-int((chan%3)))*(0.7), unitRect(unit).y() + 1.4 + 1.5*(3-int(chan/3)), 0.75, 0.75);
+}
+
+QRectF fedview::FedItem::boundingRect() const {
+    // the pens of the FE units reach out of the slot by up to one unit
+    return QGraphicsRectItem::boundingRect().adjusted(-1., -1., 1., 1.);
+}
+
+void fedview::FedItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
+    QGraphicsRectItem::paint(painter, option, widget);
+
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    QPen redpen(Qt::red);
+    QPen graypen(Qt::gray);
+    redpen.setWidth(2);
+
+    painter->save();
+    for (int j = 0; j < 8; j++) {
+        painter->setPen(unitMarked_[j] ? redpen : graypen);
+        painter->setBrush(QBrush(Qt::white));
+        painter->drawRect(unitRect(j));
+
+        if (lod < channelLod) continue;
+        for (int k = 0; k < 12; k++) {
+            painter->setPen((channelMarked_[j] & (1 << k)) ? QPen(Qt::red) : graypen);
+            painter->drawRect(channelRect(j, k));
+        }
+    }
+    painter->restore();
+}
+
+void fedview::FedItem::hoverMoveEvent(QGraphicsSceneHoverEvent* event) {
+    QString tip = fedToolTip_;
+    for (int j = 0; j < 8; j++) {
+        if (!unitRect(j).contains(event->pos())) continue;
+        tip = QString("FE Unit : ")+QString::number(j+1);
+        for (int k = 0; k < 12; k++) {
+            if (channelRect(j, k).contains(event->pos())) tip = QString("FE Channel : ")+QString::number(k+1);
+        }
+        break;
+    }
+    if (tip != toolTip()) setToolTip(tip);
+    QGraphicsRectItem::hoverMoveEvent(event);
+}
+
 fedview::Rack::Rack():
     isEmpty(true),
+    rackframe(NULL),
     x0(0.), y0(0.), width(0.), height(0.)
 {
 }
@@ -26,140 +104,53 @@ void fedview::Rack::createScene(QGraphicsScene* scene) {
 
     rackframe = scene->addRect(QRectF(x0, y0, width, height));
 
-    h.crateframe = scene->addRect(QRectF(x0+12., (0. * height/3.) + y0+30., width-24., height/3. - 60.));
-    l.crateframe = scene->addRect(QRectF(x0+12., (1. * height/3.) + y0+30., width-24., height/3. - 60.));
-    d.crateframe = scene->addRect(QRectF(x0+12., (2. * height/3.) + y0+30., width-24., height/3. - 60.));
-
-    if (!h.isEmpty) {
-        for (std::size_t i = 0; i < 21; i++) {
-            if (h.feds[i].id != 0) {
-                QPen redpen(Qt::red);
-                QPen graypen(Qt::gray);
-                redpen.setWidth(2);
-                QGraphicsRectItem* slot = scene->addRect(QRectF(x0+12.+i*16., (0. * height/3.) + y0+30., 10., height/3. - 60.), h.feds[i].isMarked ? redpen : graypen, QBrush(Qt::gray));
-                slot->setFlag(QGraphicsItem::ItemIsSelectable, true);
-                slot->setData(0, QString::number(h.feds[i].id));
-                std::stringstream tooltipss;
-                tooltipss << "FED ID : " << h.feds[i].id << std::endl;
-                tooltipss << "SLOT : " << i+1 << std::endl;
-                slot->setToolTip(tooltipss.str().c_str());
-                h.feds[i].fedframe = slot;
-                QFont fedtextfont("Times");
-                fedtextfont.setPixelSize(5);
-                h.feds[i].fedtext = scene->addText(QString::number(h.feds[i].id), fedtextfont);
-                h.feds[i].fedtext->setPos(x0+8.+i*16., (0. * height/3.) + y0+30. + height/3. - 60. + 5);
-                h.feds[i].fedtext->setVisible(false);
-                h.feds[i].slottext = scene->addText(QString::number(i+1), fedtextfont);
-                h.feds[i].slottext->setPos(x0+8.+i*16., (0. * height/3.) + y0+30.- 15);
-                h.feds[i].slottext->setVisible(false);
-
-                for (std::size_t j = 0; j < 8; j++) {
-                    bool isUnitMarked = h.feds[i].units[j].isMarked;
-                    h.feds[i].units[j].feunitframe = scene->addRect(QRectF(x0+13.+i*16., (0. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16., 8., 8), isUnitMarked ? redpen : graypen, QBrush(Qt::white));
-                    h.feds[i].units[j].feunitframe->setToolTip(QString("FE Unit : ")+QString::number(j+1));
-                    QFont fedunittextfont("Times");
-                    fedunittextfont.setPixelSize(3);
-                    h.feds[i].units[j].feunittext = scene->addText(QString::number(j+1), fedunittextfont);
-                    h.feds[i].units[j].feunittext->setPos(x0+13.+i*16., (0. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. - 10.);
-                    h.feds[i].units[j].feunittext->setVisible(false);
-                    for (int k = 0; k < 12; k++) {
-                        bool isChanMarked = h.feds[i].units[j].channels[k].isMarked;
-                        h.feds[i].units[j].channels[k].fechannelframe = 
-                        scene->addRect(QRectF(x0+14.8+i*16.+2.5*(2-int((k%3)))*(0.7), (0. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. + 1.4 + 1.5*(3-int(k/3)), 0.75, 0.75), isChanMarked ? QPen(Qt::red):graypen, QBrush(Qt::white));
-                        h.feds[i].units[j].channels[k].fechannelframe->setToolTip(QString("FE Channel : ")+QString::number(k+1));
-                        h.feds[i].units[j].channels[k].fechannelframe->setVisible(false);
-                    }
-                }
-            }
-        }
-    }
+    createCrate(scene, h, 0);
+    createCrate(scene, l, 1);
+    createCrate(scene, d, 2);
+}
 
-    if (!l.isEmpty) {
-        for (std::size_t i = 0; i < 21; i++) {
-            if (l.feds[i].id != 0) {
-                QPen redpen(Qt::red);
-                QPen graypen(Qt::gray);
-                redpen.setWidth(2);
-                QGraphicsRectItem* slot = scene->addRect(QRectF(x0+12.+i*16., (1. * height/3.) + y0+30., 10, height/3. - 60.), l.feds[i].isMarked ? redpen : graypen, QBrush(Qt::gray));
-                slot->setFlag(QGraphicsItem::ItemIsSelectable, true);
-                slot->setData(0, QString::number(l.feds[i].id));
-                std::stringstream tooltipss;
-                tooltipss << "FED ID : " << l.feds[i].id << std::endl;
-                tooltipss << "SLOT : " << i+1 << std::endl;
-                slot->setToolTip(tooltipss.str().c_str());
-                l.feds[i].fedframe = slot;
-                QFont fedtextfont("Times");
-                fedtextfont.setPixelSize(5);
-                l.feds[i].fedtext = scene->addText(QString::number(l.feds[i].id), fedtextfont);
-                l.feds[i].fedtext->setPos(x0+8.+i*16., (1. * height/3.) + y0+30. + height/3. - 60. + 5);
-                l.feds[i].fedtext->setVisible(false);
-                l.feds[i].slottext = scene->addText(QString::number(i+1), fedtextfont);
-                l.feds[i].slottext->setPos(x0+8.+i*16., (1. * height/3.) + y0+30.- 15);
-                l.feds[i].slottext->setVisible(false);
-
-                for (std::size_t j = 0; j < 8; j++) {
-                    bool isUnitMarked = l.feds[i].units[j].isMarked;
-                    l.feds[i].units[j].feunitframe = scene->addRect(QRectF(x0+13.+i*16., (1. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16., 8., 8), isUnitMarked ? redpen : graypen, QBrush(Qt::white));
-                    l.feds[i].units[j].feunitframe->setToolTip(QString("FE Unit : ")+QString::number(j+1));
-                    QFont fedunittextfont("Times");
-                    fedunittextfont.setPixelSize(3);
-                    l.feds[i].units[j].feunittext = scene->addText(QString::number(j+1), fedunittextfont);
-                    l.feds[i].units[j].feunittext->setPos(x0+13.+i*16., (1. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. - 10.);
-                    l.feds[i].units[j].feunittext->setVisible(false);
-                    for (int k = 0; k < 12; k++) {
-                        bool isChanMarked = l.feds[i].units[j].channels[k].isMarked;
-                        l.feds[i].units[j].channels[k].fechannelframe = 
-                        scene->addRect(QRectF(x0+14.8+i*16.+2.5*(2-int((k%3)))*(0.7), (1. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. + 1.4 + 1.5*(3-int(k/3)), 0.75, 0.75), isChanMarked ? QPen(Qt::red):graypen, QBrush(Qt::white));
-                        l.feds[i].units[j].channels[k].fechannelframe->setToolTip(QString("FE Channel : ")+QString::number(k+1));
-                        l.feds[i].units[j].channels[k].fechannelframe->setVisible(false);
-                    }
-                }
-            }
-        }
+void fedview::Rack::createCrate(QGraphicsScene* scene, Crate& crate, int row) {
+    crate.crateframe = scene->addRect(QRectF(x0+12., (row * height/3.) + y0+30., width-24., height/3. - 60.));
+    if (crate.isEmpty) return;
+
+    for (std::size_t i = 0; i < 21; i++) {
+        if (crate.feds[i].id == 0) continue;
+        FedItem* slot = new FedItem(QRectF(x0+12.+i*16., (row * height/3.) + y0+30., 10., height/3. - 60.), crate.feds[i], i+1);
+        scene->addItem(slot);
+        crate.feds[i].fedframe = slot;
     }
+}
+
+void fedview::Rack::createLabels(QGraphicsItem* parent) {
+    createCrateLabels(parent, h, 0);
+    createCrateLabels(parent, l, 1);
+    createCrateLabels(parent, d, 2);
+}
 
-    if (!d.isEmpty) {
-        for (std::size_t i = 0; i < 21; i++) {
-            if (d.feds[i].id != 0) {
-                QPen redpen(Qt::red);
-                QPen graypen(Qt::gray);
-                redpen.setWidth(2);
-                QGraphicsRectItem* slot = scene->addRect(QRectF(x0+12.+i*16., (2. * height/3.) + y0+30., 10., height/3. - 60.), d.feds[i].isMarked ? redpen : graypen, QBrush(Qt::gray));
-                slot->setFlag(QGraphicsItem::ItemIsSelectable, true);
-                slot->setData(0, QString::number(d.feds[i].id));
-                std::stringstream tooltipss;
-                tooltipss << "FED ID : " << d.feds[i].id << std::endl;
-                tooltipss << "SLOT : " << i+1 << std::endl;
-                slot->setToolTip(tooltipss.str().c_str());
-                d.feds[i].fedframe = slot;
-                QFont fedtextfont("Times");
-                fedtextfont.setPixelSize(5);
-                d.feds[i].fedtext = scene->addText(QString::number(d.feds[i].id), fedtextfont);
-                d.feds[i].fedtext->setPos(x0+8.+i*16., (2. * height/3.) + y0+30. + height/3. - 60. + 5);
-                d.feds[i].fedtext->setVisible(false);
-                d.feds[i].slottext = scene->addText(QString::number(i+1), fedtextfont);
-                d.feds[i].slottext->setPos(x0+8.+i*16., (2. * height/3.) + y0+30.- 15);
-                d.feds[i].slottext->setVisible(false);
-
-                for (std::size_t j = 0; j < 8; j++) {
-                    bool isUnitMarked = d.feds[i].units[j].isMarked;
-                    d.feds[i].units[j].feunitframe = scene->addRect(QRectF(x0+13.+i*16., (2. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16., 8., 8), isUnitMarked ? redpen : graypen, QBrush(Qt::white));
-                    d.feds[i].units[j].feunitframe->setToolTip(QString("FE Unit : ")+QString::number(j+1));
-                    QFont fedunittextfont("Times");
-                    fedunittextfont.setPixelSize(3);
-                    d.feds[i].units[j].feunittext = scene->addText(QString::number(j+1), fedunittextfont);
-                    d.feds[i].units[j].feunittext->setPos(x0+13.+i*16., (2. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. - 10.);
-                    d.feds[i].units[j].feunittext->setVisible(false);
-                    for (int k = 0; k < 12; k++) {
-                        bool isChanMarked = d.feds[i].units[j].channels[k].isMarked;
-                        d.feds[i].units[j].channels[k].fechannelframe = 
-                        scene->addRect(QRectF(x0+14.8+i*16.+2.5*(2-int((k%3)))*(0.7), (2. * height/3.) + y0+30. + (-2*j+15)*(height/3. - 60.)/16. + 1.4 + 1.5*(3-int(k/3)), 0.75, 0.75), isChanMarked ? QPen(Qt::red):graypen, QBrush(Qt::white));
-                        d.feds[i].units[j].channels[k].fechannelframe->setToolTip(QString("FE Channel : ")+QString::number(k+1));
-                        d.feds[i].units[j].channels[k].fechannelframe->setVisible(false);
-                    }
-                }
-            }
+void fedview::Rack::createCrateLabels(QGraphicsItem* parent, Crate& crate, int row) {
+    if (crate.isEmpty) return;
+
+    QFont fedtextfont("Times");
+    fedtextfont.setPixelSize(5);
+    QFont fedunittextfont("Times");
+    fedunittextfont.setPixelSize(3);
+
+    for (std::size_t i = 0; i < 21; i++) {
+        if (crate.feds[i].id == 0) continue;
+        QGraphicsTextItem* fedtext = new QGraphicsTextItem(QString::number(crate.feds[i].id), parent);
+        fedtext->setFont(fedtextfont);
+        fedtext->setPos(x0+8.+i*16., (row * height/3.) + y0+30. + height/3. - 60. + 5);
+        crate.feds[i].fedtext = fedtext;
+        QGraphicsTextItem* slottext = new QGraphicsTextItem(QString::number(i+1), parent);
+        slottext->setFont(fedtextfont);
+        slottext->setPos(x0+8.+i*16., (row * height/3.) + y0+30.- 15);
+        crate.feds[i].slottext = slottext;
+
+        for (std::size_t j = 0; j < 8; j++) {
+            QGraphicsTextItem* feunittext = new QGraphicsTextItem(QString::number(j+1), parent);
+            feunittext->setFont(fedunittextfont);
+            feunittext->setPos(x0+13.+i*16., (row * height/3.) + y0+30. + (-2*int(j)+15)*(height/3. - 60.)/16. - 10.);
+            crate.feds[i].units[j].feunittext = feunittext;
         }
     }
 }
-
@@ -10,9 +10,14 @@
 
 namespace fedview {
 
+    // levels of detail from which the channel grids and the labels
+    // are legible, with the initial view matrix they correspond to the
+    // zoom slider positions 16 and 21
+    const qreal channelLod = 0.74;
+    const qreal labelLod   = 1.05;
+
     struct FEChannel {
         bool isMarked;
-        QGraphicsItem* fechannelframe;
 
         FEChannel(bool isMarked_ = false):
             isMarked(isMarked_)
@@ -22,12 +27,12 @@ namespace fedview {
 
     struct FEUnit {
         bool isMarked;
-        QGraphicsItem* feunitframe;
         QGraphicsItem* feunittext;
         QVector<FEChannel> channels;
 
         FEUnit(bool isMarked_ = false):
-            isMarked(isMarked_)
+            isMarked(isMarked_),
+            feunittext(NULL)
         {
             for (int i = 0; i < 12; i++) channels.push_back(FEChannel());
         }
@@ -46,7 +51,10 @@ namespace fedview {
         FED(unsigned id_ = 0, bool isMarked_ = false ):
             id(id_),
             isMarked(isMarked_),
-            isSelected(false) 
+            isSelected(false),
+            fedframe(NULL),
+            fedtext(NULL),
+            slottext(NULL)
         {
             for (int i = 0; i < 8; i++) units.push_back(FEUnit());
         }
@@ -59,7 +67,8 @@ namespace fedview {
         QVector<FED> feds;
 
         Crate():
-            isEmpty(true)
+            isEmpty(true),
+            crateframe(NULL)
         {
             for (int i = 0; i < 21; i++) feds.push_back(FED());
         }   
@@ -90,6 +99,32 @@ namespace fedview {
         }       
     };
 
+    /**
+     * One FED slot of a crate. The slot, its FE units and their channel
+     * grids are painted by this single item, the channel grid only once
+     * the map is zoomed in far enough to make it legible. The tool tip
+     * follows the FE unit or channel under the mouse.
+     */
+    class FedItem : public QGraphicsRectItem {
+        public:
+            FedItem(const QRectF& rect, const FED& fed, unsigned slot);
+
+            QRectF boundingRect() const;
+            void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
+
+        protected:
+            void hoverMoveEvent(QGraphicsSceneHoverEvent* event);
+
+        private:
+            QRectF unitRect(int unit) const;
+            QRectF channelRect(int unit, int chan) const;
+
+            bool    fedMarked_;
+            bool    unitMarked_[8];
+            quint16 channelMarked_[8]; // one bit per channel
+            QString fedToolTip_;
+    };
+
     struct Rack {
         bool isEmpty;
         QGraphicsItem* rackframe;
@@ -102,6 +137,15 @@ namespace fedview {
         
         void setCoordinates(int, bool);
         void createScene(QGraphicsScene*);
+        /**
+         * add the FED, slot and FE unit labels as children of the given
+         * item, so that all of them are shown or hidden together
+         */
+        void createLabels(QGraphicsItem*);
+
+        private:
+        void createCrate(QGraphicsScene*, Crate&, int);
+        void createCrateLabels(QGraphicsItem*, Crate&, int);
     };
 
 }
@@ -0,0 +1,83 @@
+#include "QueryCache.h"
+#include "DbConnection.h"
+#include "Debug.h"
+
+#include <QTime>
+#include <QStringList>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+
+QueryCache* QueryCache::pInstance = 0;
+
+QString QueryCache::key(const QString& query, const QVariantList& bindValues) {
+    QStringList parts;
+    parts << query.simplified();
+    for (int i = 0; i < bindValues.size(); i++) parts << bindValues[i].toString();
+    return parts.join(QChar(0x1f));
+}
+
+QList<QSqlRecord> QueryCache::select(const QString& query, const QVariantList& bindValues, int ttl) {
+    QString k = key(query, bindValues);
+    QDateTime now = QDateTime::currentDateTime();
+
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(k);
+    if (it != entries_.constEnd() && it.value().fetched.secsTo(now) < ttl) {
+        hits_++;
+        savedMs_ += it.value().fetchMs;
+        if (Debug::Inst()->getEnabled()) qDebug() << "Query cache hit:" << hits_ << "hits," << misses_ << "misses," << savedMs_ << "ms saved";
+        return it.value().rows;
+    }
+    misses_++;
+
+    QTime timer;
+    timer.start();
+
+    QSqlQuery sqlQuery(DbConnection::Inst()->dbConnection());
+    sqlQuery.setForwardOnly(true);
+    bool result = false;
+    if (bindValues.isEmpty()) result = sqlQuery.exec(query);
+    else {
+        result = sqlQuery.prepare(query);
+        for (int i = 0; result && i < bindValues.size(); i++) sqlQuery.addBindValue(bindValues[i]);
+        if (result) result = sqlQuery.exec();
+    }
+    if (!result) {
+        if (Debug::Inst()->getEnabled()) qDebug() << "Query failed:" << sqlQuery.lastError().text();
+        return QList<QSqlRecord>();
+    }
+
+    Entry entry;
+    while (sqlQuery.next()) entry.rows.push_back(sqlQuery.record());
+    entry.fetched = now;
+    entry.fetchMs = timer.elapsed();
+    entries_.insert(k, entry);
+
+    if (Debug::Inst()->getEnabled()) qDebug() << "Query cache miss:" << entry.fetchMs << "ms," << hits_ << "hits," << misses_ << "misses";
+    return entry.rows;
+}
+
+bool QueryCache::find(const QString& query, const QVariantList& bindValues, QList<QSqlRecord>& rows, int ttl) {
+    QHash<QString, Entry>::const_iterator it = entries_.constFind(key(query, bindValues));
+    if (it == entries_.constEnd() || it.value().fetched.secsTo(QDateTime::currentDateTime()) >= ttl) {
+        misses_++;
+        return false;
+    }
+    hits_++;
+    savedMs_ += it.value().fetchMs;
+    if (Debug::Inst()->getEnabled()) qDebug() << "Query cache hit:" << hits_ << "hits," << misses_ << "misses," << savedMs_ << "ms saved";
+    rows = it.value().rows;
+    return true;
+}
+
+void QueryCache::insert(const QString& query, const QVariantList& bindValues, const QList<QSqlRecord>& rows, int fetchMs) {
+    Entry entry;
+    entry.rows    = rows;
+    entry.fetched = QDateTime::currentDateTime();
+    entry.fetchMs = fetchMs;
+    entries_.insert(key(query, bindValues), entry);
+}
+
+void QueryCache::invalidate() {
+    if (Debug::Inst()->getEnabled()) qDebug() << "Query cache invalidated," << entries_.size() << "entries dropped";
+    entries_.clear();
+}
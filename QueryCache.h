@@ -0,0 +1,100 @@
+#ifndef QUERYCACHE_H
+#define QUERYCACHE_H
+
+// Qt includes
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include <QDateTime>
+#include <QtSql/QSqlRecord>
+
+/** \Class QueryCache
+ *
+ * \brief Singleton read-through cache for repeated metadata queries
+ *
+ * The partition, run and version lookups of the startup page, the
+ * multi partition page and the global preparation are sent again every
+ * time the selection changes, although their answers rarely do. Results
+ * are kept per normalized query text and bind values for a limited time.
+ * Anything that writes to the database, or asks explicitly for fresh
+ * values, has to call #invalidate. The cache runs its queries on the main
+ * connection, or holds the results of queries run through the
+ * DbQueryExecutor, and is only meant to be used from the GUI thread.
+ */
+class QueryCache {
+    private:
+        static QueryCache* pInstance;
+
+        struct Entry {
+            QList<QSqlRecord> rows;    // result rows
+            QDateTime         fetched; // time the rows were retrieved
+            int               fetchMs; // round trip time of the query
+        };
+
+        QHash<QString, Entry> entries_;
+        unsigned hits_;
+        unsigned misses_;
+        qint64   savedMs_;
+
+        /**
+         * key of a query, with blanks collapsed so that differently
+         * formatted copies of the same query share their entry
+         */
+        static QString key(const QString& query, const QVariantList& bindValues);
+
+    protected:
+        /**
+         * constructor
+         */
+        QueryCache():
+            hits_(0),
+            misses_(0),
+            savedMs_(0)
+        {
+        }
+
+    public:
+        static const int defaultTtl = 300; /**< seconds a result stays valid */
+
+        /**
+         * return static instance of this class
+         */
+        static QueryCache* Inst() {
+            if(pInstance == 0) pInstance = new QueryCache();
+            return pInstance;
+        }
+
+        /**
+         * return the rows of a query, from the cache if they were retrieved
+         * less than ttl seconds ago. The bind values are applied in order
+         * to the placeholders of the query. Failed queries are not cached
+         * and return no rows
+         */
+        QList<QSqlRecord> select(const QString& query, const QVariantList& bindValues = QVariantList(), int ttl = defaultTtl);
+
+        /**
+         * copy the cached rows of a query into rows if they were retrieved
+         * less than ttl seconds ago, without querying the database on a
+         * miss. For queries run through the DbQueryExecutor
+         */
+        bool find(const QString& query, const QVariantList& bindValues, QList<QSqlRecord>& rows, int ttl = defaultTtl);
+
+        /**
+         * store the rows of a query retrieved elsewhere, fetchMs being the
+         * time it took to retrieve them
+         */
+        void insert(const QString& query, const QVariantList& bindValues, const QList<QSqlRecord>& rows, int fetchMs);
+
+        /**
+         * drop all cached results, to be called after writing to the
+         * database
+         */
+        void invalidate();
+
+        unsigned hits()    const { return hits_;    }
+        unsigned misses()  const { return misses_;  }
+        qint64   savedMs() const { return savedMs_; }
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "SelectionEngine.h"
+#include "Debug.h"
+
+#include <TTree.h>
+#include <TTreeFormula.h>
+#include <TEventList.h>
+
+SelectionEngine::SelectionEngine():
+    nEntries_(0),
+    is2D_(false),
+    scalar_(true),
+    nSelections_(0)
+{
+}
+
+bool SelectionEngine::load(TTree* tree, const QString& x, const QString& y, const QString& validCut) {
+    nEntries_ = 0;
+    entries_.clear();
+    xs_.clear();
+    ys_.clear();
+    valid_.clear();
+    scalar_ = true;
+    reset();
+    if (tree == NULL || x.isEmpty()) return false;
+
+    is2D_ = !y.isEmpty();
+    TTreeFormula xform("selx", qPrintable(x), tree);
+    TTreeFormula yform("sely", qPrintable(is2D_ ? y : QString("1")), tree);
+    TTreeFormula cform("selc", qPrintable(validCut.isEmpty() ? QString("1") : validCut), tree);
+    if (xform.GetNdim() == 0 || yform.GetNdim() == 0 || cform.GetNdim() == 0) {
+        if (Debug::Inst()->getEnabled()) qDebug() << "Unable to compile the selection expressions " << x << ", " << y << ", " << validCut;
+        return false;
+    }
+
+    nEntries_ = tree->GetEntries();
+    entries_.reserve(nEntries_);
+    xs_.reserve(nEntries_);
+    if (is2D_) ys_.reserve(nEntries_);
+
+    std::vector<bool> valid;
+    valid.reserve(nEntries_);
+    for (Long64_t i = 0; i < nEntries_; i++) {
+        tree->LoadTree(i);
+        int ndata = xform.GetNdata();
+        if (is2D_ && yform.GetNdata() < ndata) ndata = yform.GetNdata();
+        int ncut = cform.GetNdata();
+        if (ndata > 1) scalar_ = false;
+        for (int k = 0; k < ndata; k++) {
+            entries_.push_back(i);
+            xs_.push_back(xform.EvalInstance(k));
+            if (is2D_) ys_.push_back(yform.EvalInstance(k));
+            valid.push_back(cform.EvalInstance(k < ncut ? k : 0) != 0);
+        }
+    }
+
+    valid_.assign((entries_.size() + 63) / 64, 0);
+    for (size_t i = 0; i < valid.size(); i++) if (valid[i]) setBit(valid_, i);
+    selected_.assign(valid_.size(), 0);
+
+    if (Debug::Inst()->getEnabled()) qDebug() << "Selection columns loaded with " << entries_.size() << " instances from " << nEntries_ << " entries";
+    return true;
+}
+
+void SelectionEngine::reset() {
+    selected_.assign(valid_.size(), 0);
+    nSelections_ = 0;
+}
+
+void SelectionEngine::select(double xmin, double xmax, double ymin, double ymax, bool unselect) {
+    Bitmap rect(selected_.size(), 0);
+    const size_t n = xs_.size();
+    for (size_t i = 0; i < n; i++) {
+        bool inside = xs_[i] >= xmin && xs_[i] < xmax;
+        if (is2D_) inside = inside && ys_[i] >= ymin && ys_[i] < ymax;
+        if (inside) setBit(rect, i);
+    }
+
+    // the first rubber band defines the selection, later ones refine it
+    for (size_t w = 0; w < selected_.size(); w++) {
+        if (!unselect)             selected_[w] |= rect[w];
+        else if (nSelections_ > 0) selected_[w] &= ~rect[w];
+        else                       selected_[w]  = ~rect[w];
+    }
+    nSelections_++;
+}
+
+void SelectionEngine::fillSelMap(QVector<int>& selMap) const {
+    for (int i = 0; i < selMap.size(); i++) selMap[i] = 0;
+    for (size_t w = 0; w < selected_.size(); w++) {
+        uint64_t bits = selected_[w] & valid_[w];
+        for (size_t b = 0; bits != 0; b++, bits >>= 1) {
+            if ((bits & 1) == 0) continue;
+            Long64_t entry = entries_[w * 64 + b];
+            if (entry < selMap.size()) selMap[entry] = 1;
+        }
+    }
+}
+
+void SelectionEngine::fillEventList(TEventList* list) const {
+    if (list == NULL) return;
+    list->Reset();
+    Long64_t last = -1;
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i] == last || !testBit(selected_, i) || !testBit(valid_, i)) continue;
+        last = entries_[i];
+        list->Enter(last);
+    }
+}
+
+void SelectionEngine::selectedInstances(std::vector<double>& xs, std::vector<double>& ys) const {
+    xs.clear();
+    ys.clear();
+    for (size_t i = 0; i < xs_.size(); i++) {
+        if (!testBit(selected_, i) || !testBit(valid_, i)) continue;
+        xs.push_back(xs_[i]);
+        if (is2D_) ys.push_back(ys_[i]);
+    }
+}
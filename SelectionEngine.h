@@ -0,0 +1,96 @@
+#ifndef SELECTIONENGINE_H
+#define SELECTIONENGINE_H
+
+#include <QString>
+#include <QVector>
+
+#include <Rtypes.h>
+
+#include <stdint.h>
+#include <vector>
+
+class TTree;
+class TEventList;
+
+/** \Class SelectionEngine
+ *
+ * \brief Keeps the selection made with rubber bands in the TreeViewer
+ * as a bitmap over memory resident columns
+ *
+ * The plotted x and y expressions and the validity cut are evaluated
+ * once over the tree when a plot is drawn. Every rubber band is then
+ * evaluated over the columns in memory and combined with the previous
+ * selection through bitwise OR (select) or AND NOT (unselect), so the
+ * cost of a selection does not depend on the number of earlier ones.
+ * As with TTree::Draw, expressions over arrays give one instance per
+ * array element, and an entry is selected if any of its instances is.
+ */ 
+class SelectionEngine {
+    public:
+        SelectionEngine();
+
+        /**
+         * evaluate the x and y expressions and the validity cut over all
+         * entries of the tree and clear the selection. y may be empty
+         * for 1D plots. Returns false if an expression can not be compiled
+         */
+        bool load(TTree* tree, const QString& x, const QString& y, const QString& validCut);
+
+        /**
+         * clear the selection
+         */
+        void reset();
+
+        /**
+         * add the instances inside [xmin, xmax) x [ymin, ymax) to the
+         * selection, or remove them if unselect is set. The y range is
+         * ignored for 1D plots
+         */
+        void select(double xmin, double xmax, double ymin, double ymax, bool unselect);
+
+        /**
+         * number of rubber bands combined into the current selection
+         */
+        int nSelections() const { return nSelections_; }
+
+        /**
+         * set the entries of the selection map to 1 for selected entries
+         * and 0 otherwise
+         */
+        void fillSelMap(QVector<int>& selMap) const;
+
+        /**
+         * fill the event list with the selected entries
+         */
+        void fillEventList(TEventList* list) const;
+
+        /**
+         * true if no entry has more than one instance, so that selecting
+         * entries is the same as selecting instances
+         */
+        bool isScalar() const { return scalar_; }
+
+        /**
+         * copy the coordinates of the selected valid instances. ys is
+         * left empty for 1D plots
+         */
+        void selectedInstances(std::vector<double>& xs, std::vector<double>& ys) const;
+
+    private:
+        typedef std::vector<uint64_t> Bitmap;
+
+        Long64_t              nEntries_;
+        bool                  is2D_;
+        bool                  scalar_;
+        int                   nSelections_;
+        std::vector<Long64_t> entries_;  /**< tree entry of each instance */
+        std::vector<double>   xs_;
+        std::vector<double>   ys_;
+        Bitmap                valid_;
+        Bitmap                selected_;
+
+        static void setBit(Bitmap& bits, size_t i) { bits[i >> 6] |= (uint64_t(1) << (i & 63)); }
+        static bool testBit(const Bitmap& bits, size_t i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+};
+
+#endif
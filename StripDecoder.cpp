@@ -0,0 +1,64 @@
+#include "StripDecoder.h"
+
+namespace {
+    // lookup table of base64 digit values, -1 for characters which are skipped
+    struct Base64Table {
+        signed char value[256];
+        Base64Table() {
+            for (int i = 0; i < 256; i++) value[i] = -1;
+            const char* digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; i++) value[static_cast<unsigned char>(digits[i])] = i;
+        }
+    };
+
+    const Base64Table base64Table;
+}
+
+int StripDecoder::decodeWords(const char* clob, int length, uint32_t* words, int maxWords) {
+    uint32_t bits  = 0;  // pending bits from the base64 digits
+    int      nbits = 0;
+    uint32_t word  = 0;  // strip word being assembled, little endian
+    int      nbyte = 0;
+    int      nword = 0;
+
+    for (int i = 0; i < length; i++) {
+        if (clob[i] == '=') break;
+        int digit = base64Table.value[static_cast<unsigned char>(clob[i])];
+        if (digit < 0) continue;
+
+        bits = (bits << 6) | digit;
+        nbits += 6;
+        if (nbits < 8) continue;
+        nbits -= 8;
+
+        word |= ((bits >> nbits) & 0xFF) << (8 * nbyte);
+        if (++nbyte == 4) {
+            if (nword < maxWords) words[nword] = word;
+            nword++;
+            word  = 0;
+            nbyte = 0;
+        }
+    }
+
+    // a trailing incomplete word is kept with its bytes in the low positions
+    if (nbyte > 0) {
+        if (nword < maxWords) words[nword] = word;
+        nword++;
+    }
+    return nword;
+}
+
+void StripDecoder::unpack(const uint32_t* words, int n, double* noise, double* pedestal) {
+    // kept free of branches so that the compiler can vectorize it
+    for (int i = 0; i < n; i++) {
+        noise[i]    = static_cast<float>( static_cast<float>( ( words[i] >> 13 ) & 0x000001FF ) / 10.0 );
+        pedestal[i] = static_cast<double>( ( words[i] >> 22 ) & 0x000003FF );
+    }
+}
+
+int StripDecoder::decode(const char* clob, int length, double* noise, double* pedestal) {
+    uint32_t words[nStrips];
+    int nword = decodeWords(clob, length, words, nStrips);
+    unpack(words, nword < nStrips ? nword : nStrips, noise, pedestal);
+    return nword;
+}
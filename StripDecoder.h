@@ -0,0 +1,40 @@
+#ifndef STRIPDECODER_H
+#define STRIPDECODER_H
+
+#include <stdint.h>
+
+/** \Class StripDecoder
+ *
+ * \brief Decoder for the base64 encoded strip CLOBs of the FED
+ * description, as retrieved by TreeBuilder::getState
+ *
+ * Every strip is stored as a little endian 32 bit word. The pedestal
+ * sits in bits 22-31 and the noise (in units of 0.1 ADC) in bits 13-21.
+ * The base64 text is decoded directly into the packed words, without
+ * any intermediate hex representation or heap allocation.
+ */
+class StripDecoder {
+    public:
+        static const int nStrips = 128; /**< number of strips of an APV */
+
+        /**
+         * decode a base64 CLOB of the given length into packed strip
+         * words. At most maxWords words are written; the return value is
+         * the number of words found in the CLOB, which can be larger
+         */
+        static int decodeWords(const char* clob, int length, uint32_t* words, int maxWords);
+
+        /**
+         * extract noise and pedestal of n strips from packed strip words
+         */
+        static void unpack(const uint32_t* words, int n, double* noise, double* pedestal);
+
+        /**
+         * decode a base64 CLOB straight into the noise and pedestal
+         * arrays of one APV. Strips missing from the CLOB are left
+         * untouched. Returns the number of words found in the CLOB
+         */
+        static int decode(const char* clob, int length, double* noise, double* pedestal);
+};
+
+#endif
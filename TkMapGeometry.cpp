@@ -0,0 +1,196 @@
+#include "TkMapGeometry.h"
+
+#include <QFileInfo>
+#include <QByteArray>
+#include <QtAlgorithms>
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+    bool detidLessThan(const TkMapGeometry::Module& a, const TkMapGeometry::Module& b) {
+        return a.detid < b.detid;
+    }
+
+    bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+}
+
+TkMapGeometry::TkMapGeometry():
+    modules_(NULL),
+    count_(0)
+{
+}
+
+TkMapGeometry::~TkMapGeometry() {
+    clear();
+}
+
+void TkMapGeometry::clear() {
+    if (file_.isOpen()) file_.close(); // also unmaps the table
+    parsed_.clear();
+    modules_ = NULL;
+    count_ = 0;
+}
+
+bool TkMapGeometry::load(const QString& baseName) {
+    QFileInfo ascii(baseName);
+    QFileInfo binary(baseName + ".bin");
+
+    if (binary.exists() && (!ascii.exists() || binary.lastModified() >= ascii.lastModified())) {
+        if (loadBinary(binary.filePath())) return true;
+        std::cerr << "Ignoring invalid tk map layout table " << qPrintable(binary.filePath()) << std::endl;
+    }
+    return loadAscii(ascii.filePath());
+}
+
+bool TkMapGeometry::loadBinary(const QString& fileName) {
+    clear();
+
+    file_.setFileName(fileName);
+    if (!file_.open(QIODevice::ReadOnly)) return false;
+
+    qint64 length = file_.size();
+    if (length < qint64(sizeof(Header))) {
+        clear();
+        return false;
+    }
+
+    const uchar* data = file_.map(0, length);
+    if (data == NULL) {
+        clear();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (header->magic != magic || header->version != version || header->recordSize != sizeof(Module) ||
+        length != qint64(sizeof(Header)) + qint64(header->count) * qint64(sizeof(Module))) {
+        clear();
+        return false;
+    }
+
+    modules_ = reinterpret_cast<const Module*>(data + sizeof(Header));
+    count_   = header->count;
+    return true;
+}
+
+bool TkMapGeometry::loadAscii(const QString& fileName) {
+    clear();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray content = file.readAll();
+    file.close();
+
+    const char* p   = content.constData();
+    const char* end = p + content.size();
+    int count = 0;
+
+    while (p < end) {
+        ++count;
+        const char* eol = p;
+        while (eol < end && *eol != '\n') ++eol;
+
+        Module module;
+        module.detid   = 0;
+        module.nPoints = 0;
+        int nx = 0, ny = 0, nfields = 0;
+        bool tooLong = false;
+
+        // fields are separated by blanks and the number of points is
+        // not fixed: detid first, then alternating y and x coordinates
+        const char* q = p;
+        while (q < eol) {
+            while (q < eol && isBlank(*q)) ++q;
+            if (q == eol) break;
+
+            char* next = NULL;
+            if (nfields == 0) {
+                module.detid = static_cast<quint32>(strtoll(q, &next, 10));
+            }
+            else {
+                double value = strtod(q, &next);
+                if (nfields % 2 == 1) {
+                    if (ny < maxPoints) module.y[ny] = value;
+                    else tooLong = true;
+                    ++ny;
+                }
+                else {
+                    if (nx < maxPoints) module.x[nx] = value;
+                    else tooLong = true;
+                    ++nx;
+                }
+            }
+            ++nfields;
+
+            q = next;
+            while (q < eol && !isBlank(*q)) ++q;
+        }
+        p = eol + 1;
+
+        // no content, move on
+        if (nfields == 0) continue;
+
+        if (module.detid == 0) {
+            std::cerr << "Could not parse any detid from line " << count << std::endl;
+            continue;
+        }
+        if (nx != ny) {
+            std::cerr << "Did not find the same number of x and y points in line " << count << std::endl;
+            continue;
+        }
+        if (nx == 0) {
+            std::cerr << "Did not find any points for detid " << module.detid << " in line " << count << std::endl;
+            continue;
+        }
+        if (tooLong) {
+            std::cerr << "Found more than " << maxPoints << " points for detid " << module.detid << " in line " << count << std::endl;
+            continue;
+        }
+
+        module.nPoints = nx;
+        for (int i = nx; i < maxPoints; i++) {
+            module.x[i] = 0;
+            module.y[i] = 0;
+        }
+        parsed_.push_back(module);
+    }
+
+    qStableSort(parsed_.begin(), parsed_.end(), detidLessThan);
+    modules_ = parsed_.constData();
+    count_   = parsed_.size();
+    return true;
+}
+
+bool TkMapGeometry::saveBinary(const QString& fileName) const {
+    Header header;
+    header.magic      = magic;
+    header.version    = version;
+    header.recordSize = sizeof(Module);
+    header.count      = count_;
+
+    QFile file(fileName + ".tmp");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) == qint64(sizeof(Header));
+    if (ok && count_ > 0) ok = file.write(reinterpret_cast<const char*>(modules_), qint64(count_) * sizeof(Module)) == qint64(count_) * qint64(sizeof(Module));
+    file.close();
+
+    if (!ok) {
+        file.remove();
+        return false;
+    }
+    QFile::remove(fileName);
+    return file.rename(fileName);
+}
+
+const TkMapGeometry::Module* TkMapGeometry::find(quint32 detid) const {
+    int lo = 0, hi = count_;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (modules_[mid].detid < detid) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < count_ && modules_[lo].detid == detid) return &modules_[lo];
+    return NULL;
+}
@@ -0,0 +1,84 @@
+#ifndef TKMAPGEOMETRY_H
+#define TKMAPGEOMETRY_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+/** \Class TkMapGeometry
+ *
+ * \brief Module outlines of the tracker map, as drawn by TkMap
+ *
+ * The layout is shipped as the ASCII file tkmap_bare, with one line
+ * "detid x1 y1 ... xn yn" per module. At build time tkmapconv turns it
+ * into a binary table (tkmap_bare.bin) of fixed size records sorted by
+ * detid, preceded by a small header carrying a magic word, the format
+ * version and the record size. The binary table is memory mapped and
+ * used in place; the ASCII file is only parsed when no up to date binary
+ * table is available.
+ */
+class TkMapGeometry {
+    public:
+        static const int maxPoints = 4; /**< maximum number of corners of a module outline */
+        static const quint32 magic = 0x424D4B54; /**< "TKMB" */
+        static const quint32 version = 2; /**< to be increased whenever the record layout or its meaning changes */
+
+        struct Module {
+            quint32 detid;
+            quint32 nPoints;
+            float   x[maxPoints];
+            float   y[maxPoints];
+        };
+
+        TkMapGeometry();
+        ~TkMapGeometry();
+
+        /**
+         * load the layout from baseName.bin if it exists, is valid and is
+         * not older than baseName, otherwise parse the ASCII file baseName
+         */
+        bool load(const QString& baseName);
+
+        /**
+         * map a binary table written by saveBinary
+         */
+        bool loadBinary(const QString& fileName);
+
+        /**
+         * parse the ASCII layout. Malformed lines are reported and skipped
+         */
+        bool loadAscii(const QString& fileName);
+
+        /**
+         * write the loaded modules as binary table
+         */
+        bool saveBinary(const QString& fileName) const;
+
+        int size() const { return count_; }
+        const Module& module(int i) const { return modules_[i]; }
+
+        /**
+         * return the module with the given detid, NULL if there is none
+         */
+        const Module* find(quint32 detid) const;
+
+    private:
+        struct Header {
+            quint32 magic;
+            quint32 version;
+            quint32 recordSize;
+            quint32 count;
+        };
+
+        void clear();
+
+        QFile           file_;
+        QVector<Module> parsed_;
+        const Module*   modules_;
+        int             count_;
+
+        TkMapGeometry(const TkMapGeometry&);
+        TkMapGeometry& operator=(const TkMapGeometry&);
+};
+
+#endif
@@ -5,6 +5,9 @@
 #include "TROOT.h"
 #include "TStyle.h"
 
+#include <QColor>
+#include <QVector>
+
 
 static const int kSubdetOffset       = 25; /**< offset to extract subdetector ID from detid */
 
@@ -33,12 +36,55 @@ static const unsigned ringStartBitTID_= 9;  /**< start bit to extract TID ring f
 static const unsigned ringMaskTID_= 0x3;    /**< mask to extract TID ring from detid */
 static const unsigned ringStartBitTEC_= 5;  /**< start bit to extract TEC ring from detid */
 static const unsigned ringMaskTEC_= 0x7;    /**< mask to extract TEC ring from detid */
+static const unsigned sideStartBitTID_= 13; /**< start bit to extract TID side from detid */
+static const unsigned sideMaskTID_= 0x3;    /**< mask to extract TID side from detid */
+static const unsigned wheelStartBitTID_= 11;/**< start bit to extract TID wheel from detid */
+static const unsigned wheelMaskTID_= 0x3;   /**< mask to extract TID wheel from detid */
+static const unsigned sideStartBitTEC_= 18; /**< start bit to extract TEC side from detid */
+static const unsigned sideMaskTEC_= 0x3;    /**< mask to extract TEC side from detid */
+static const unsigned wheelStartBitTEC_= 14;/**< start bit to extract TEC wheel from detid */
+static const unsigned wheelMaskTEC_= 0xF;   /**< mask to extract TEC wheel from detid */
+
+/**
+ * An enum to define the level of detail tiers of the tracker map
+ */
+enum DetailTier 
+  {
+    LAYER_TIER  = 0, /**< zoomed out: layers are drawn from cached images */
+    MODULE_TIER = 1, /**< module polygons are drawn */
+    APV_TIER    = 2  /**< zoomed in: the APVs of the modules are drawn */
+  };
+
+static const double moduleTierLod_ = 0.55;  /**< level of detail from which module polygons are drawn */
+static const double apvTierLod_    = 3.0;   /**< level of detail from which APV polygons are drawn */
 
 /** 
  * inline method to extract subdet ID from detid
  */
 inline int subdet(const unsigned int& id_) { return ((id_>>kSubdetOffset)&0x7); }
 
+/** 
+ * inline method to get the level of detail tier from the level of
+ * detail of a QStyleOptionGraphicsItem
+ */
+inline int detailTier(double lod) { return lod < moduleTierLod_ ? LAYER_TIER : ( lod < apvTierLod_ ? MODULE_TIER : APV_TIER ); }
+
+/** 
+ * inline method to extract a layer (or side and wheel for the
+ * disks) identifier from detid, unique within the tracker
+ */
+inline unsigned layerId(const unsigned int& id_)
+{
+  switch(subdet(id_)) {
+  case TIB: 
+  case TOB: return (subdet(id_)<<8) | ((id_>>layerStartBit_) & layerMask_);
+  case TID: return (TID<<8) | (((id_>>sideStartBitTID_) & sideMaskTID_)<<4) | ((id_>>wheelStartBitTID_) & wheelMaskTID_);
+  case TEC: return (TEC<<8) | (((id_>>sideStartBitTEC_) & sideMaskTEC_)<<4) | ((id_>>wheelStartBitTEC_) & wheelMaskTEC_);
+  default: 
+    return 0;
+  }
+}
+
 /** 
  * inline method to extract module geometry from detid
  */
@@ -106,54 +152,73 @@ class M
   /**
    * set new minimum
    */ 
-  void nMin(float rhs) { min_ = rhs; range_ = max_ - min_; }
+  void nMin(float rhs) { min_ = rhs; range_ = max_ - min_; colorsValid_ = false; ++colorVersion_; }
   /**
    * set new maximum
    */ 
-  void nMax(float rhs) { max_ = rhs; range_ = max_ - min_; }
+  void nMax(float rhs) { max_ = rhs; range_ = max_ - min_; colorsValid_ = false; ++colorVersion_; }
+  /**
+   * force the color table to be rebuilt, to be called when the ROOT
+   * palette has been changed
+   */
+  void invalidateColors() { colorsValid_ = false; ++colorVersion_; }
+  /**
+   * get a counter which changes whenever the value to color mapping
+   * changes, for images drawn with these colors
+   */
+  unsigned colorVersion() { return colorVersion_; }
+  /**
+   * get number of colors of the palette
+   */
+  int nColors() { if( !colorsValid_ ) buildColors(); return nColors_; }
+  /**
+   * get color for a value on the scale from #min to #max
+   */
+  QColor color(float value) 
+  {
+    // value is zero
+    if( value < 1e-6 && value > -1e-6 ) return QColor(Qt::white);
+    // value is smaller than minimum of scale
+    if( value < min_ ) return QColor::fromRgbF(0.573333, 0.0, 1.0);
+    // value is greater than maximum of scale
+    if( value > max_ ) return QColor::fromRgbF(1.0, 0.0, 0.0);
+
+    if( !colorsValid_ ) buildColors();
+    int index = static_cast<int>( ( value - min_ ) * stepsize_ );
+    if( index < 0 || index >= colors_.size() ) return QColor(Qt::white);
+    return colors_[index];
+  }
  private:
-  M( ) {};
+  M( ) : min_(0), max_(0), range_(0), colorsValid_(false), colorVersion_(0), nColors_(0), stepsize_(0) {};
+  /**
+   * fill the color table from the ROOT rainbow palette, so that the
+   * painting code does not need to touch gStyle and gROOT
+   */
+  void buildColors()
+  {
+    gStyle->SetPalette(1);
+    nColors_ = gStyle->GetNumberOfColors();
+    stepsize_ = static_cast<Float_t>(nColors_-1) / range_;
+
+    // magic number 51 => default number of colors in the TPalette which consitute the 'rainbow'
+    colors_.resize(nColors_+1);
+    for( int i = 0; i < colors_.size(); ++i ) {
+      TColor *color = gROOT->GetColor(i + 51);
+      Float_t r = 1.0, g = 1.0, b = 1.0;
+      if( color ) color->GetRGB(r,g,b);
+      colors_[i] = QColor::fromRgbF(r,g,b);
+    }
+    colorsValid_ = true;
+  }
   float min_; /*!< minimum */
   float max_; /*!< maximum */
   float range_; /*!< range between minimum and maximum */
+  bool colorsValid_; /*!< false when the color table needs to be rebuilt */
+  unsigned colorVersion_; /*!< incremented whenever the value to color mapping changes */
+  int nColors_; /*!< number of colors of the palette */
+  float stepsize_; /*!< number of colors per unit of the scale */
+  QVector<QColor> colors_; /*!< color table of the palette */
 };
 
-/**
- * inline method to get r,g,b color values for a value 
- * relies on #M singleton class
- * @param[in] value  
- * @param[out] r,g,b red green and blue color values (range [0:1])
- */
-inline void getColor(float value, float &r , float &g, float &b) 
-{
-  gStyle->SetPalette(1);
-  Int_t nColors = gStyle->GetNumberOfColors()-1;
-
-  // value is zero
-  if ( value < 1e-6 && value > -1e-6)   { 
-    r = 1.0; g = 1.0; b = 1.0; 
-    return; 
-  } 
-  // value is smaller than minimum of scale
-  if( value < M::m()->min() ) {
-    r=0.573333; g=0.0; b=1.0;
-    return;
-  }
-  // value is greater than maximum of scale
-  if( value > M::m()->max() ) {
-    r=1.0; g=0.0; b=0.0;
-    return;
-  }
-  
-  Float_t stepsize = static_cast<Float_t>(nColors) / M::m()->range();
-  // magic number 51 => default number of colors in the TPalette which consitute the 'rainbow'
-  TColor *color = gROOT->GetColor(static_cast<Int_t>( (  value - M::m()->min() )  * stepsize + 51 ) ) ;
-  if( !color  ) { r = 1.0; g = 1.0; b = 1.0; return; } 
-  color->GetRGB(r,g,b);
-  return;
-}
-
-
-
 
 #endif
@@ -40,6 +40,8 @@
 ****************************************************************************/
 
 #include "TkView.h"
+#include "Chip.h"
+#include "ChipIndex.h"
 
 #include <QtGui>
 
@@ -48,7 +50,6 @@
 
 
 void GraphicsView::drawBackground(QPainter *painter, const QRectF &rect) {
-    gStyle->SetPalette(1);
     painter->save();
     painter->setBrush(QColor(Qt::white));
     painter->drawRect(rect);
@@ -66,12 +67,12 @@ void GraphicsView::drawBackground(QPainter *painter, const QRectF &rect) {
     painter->drawText(2100,-1020,"TOB L4");
     painter->drawText(2500,-325,"TOB L5");
     painter->drawText(2500,-1020,"TOB L6");
-    float r=1.0,g=1.0,b=1.0;
-    for( int i = 0; i < gStyle->GetNumberOfColors()-1; ++i ) {
-        getColor( M::m()->min()+i*(M::m()->range()/gStyle->GetNumberOfColors()),r,g,b);
+    int nColors = M::m()->nColors();
+    for( int i = 0; i < nColors-1; ++i ) {
+        float value = M::m()->min()+i*(M::m()->range()/nColors);
         if( scene() ) {
-            if( i % 5 == 0 ) painter->drawText(3050, -210-i*20, QString::number(M::m()->min()+i*(M::m()->range()/gStyle->GetNumberOfColors()),'g',3) );
-            painter->setBrush(QColor::fromRgbF(r,g,b));
+            if( i % 5 == 0 ) painter->drawText(3050, -210-i*20, QString::number(value,'g',3) );
+            painter->setBrush(M::m()->color(value));
             painter->drawRect(3000, -200-i*20,30,20);
         }
     }
@@ -89,6 +90,63 @@ void GraphicsView::wheelEvent(QWheelEvent *e) {
     else QGraphicsView::wheelEvent(e);
 }
 
+void GraphicsView::mousePressEvent(QMouseEvent *e) {
+    // a rubber band starts where no module takes the press, as in
+    // QGraphicsView, but the selection is then run on the module index
+    // rather than on the index of the scene
+    if (index && scene() && isInteractive() && dragMode() == QGraphicsView::RubberBandDrag && e->button() == Qt::LeftButton && !index->chipAt(mapToScene(e->pos()))) {
+        if (!(e->modifiers() & Qt::ControlModifier)) scene()->clearSelection();
+        bandSelection.clear();
+        bandOrigin = e->pos();
+        if (!rubberBand) rubberBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+        rubberBand->setGeometry(QRect(bandOrigin, QSize()));
+        rubberBand->show();
+        e->accept();
+        return;
+    }
+    QGraphicsView::mousePressEvent(e);
+}
+
+void GraphicsView::mouseMoveEvent(QMouseEvent *e) {
+    if (rubberBand && rubberBand->isVisible()) {
+        QRect band = QRect(bandOrigin, e->pos()).normalized();
+        rubberBand->setGeometry(band);
+
+        QVector<Chip*> hits;
+        index->query(mapToScene(band).boundingRect(), hits);
+
+        // only touch the modules entering or leaving the band
+        QSet<Chip*> inBand;
+        for (int i = 0; i < hits.size(); ++i) {
+            Chip* chip = hits[i];
+            if (!(chip->flags() & QGraphicsItem::ItemIsSelectable)) continue;
+            inBand.insert(chip);
+            if (!bandSelection.contains(chip) && !chip->isSelected()) {
+                chip->setSelected(true);
+                bandSelection.insert(chip);
+            }
+        }
+        for (QSet<Chip*>::iterator it = bandSelection.begin(); it != bandSelection.end(); ) {
+            if (inBand.contains(*it)) { ++it; continue; }
+            (*it)->setSelected(false);
+            it = bandSelection.erase(it);
+        }
+        e->accept();
+        return;
+    }
+    QGraphicsView::mouseMoveEvent(e);
+}
+
+void GraphicsView::mouseReleaseEvent(QMouseEvent *e) {
+    if (rubberBand && rubberBand->isVisible()) {
+        rubberBand->hide();
+        bandSelection.clear();
+        e->accept();
+        return;
+    }
+    QGraphicsView::mouseReleaseEvent(e);
+}
+
 View::View(const QString &, QWidget *parent, double minv, double maxv)
     : QFrame(parent)
 {
@@ -226,10 +284,32 @@ QGraphicsView *View::view() const {
     return static_cast<QGraphicsView *>(graphicsView);
 }
 
+void View::setRange(double minv, double maxv) {
+    if (minv >= maxv) {
+        minv = 2.0;
+        maxv = 6.0;
+    }        
+    // set both values before the checks of minChanged and maxChanged
+    // compare them with each other
+    sbMin->blockSignals(true);
+    sbMax->blockSignals(true);
+    sbMin->setValue(minv);
+    sbMax->setValue(maxv);
+    sbMin->setSingleStep ((maxv-minv)/25.);
+    sbMax->setSingleStep ((maxv-minv)/25.);
+    sbMin->blockSignals(false);
+    sbMax->blockSignals(false);
+
+    M::m()->nMin(sbMin->value());
+    M::m()->nMax(sbMax->value());
+    viewUpdate();
+}
+
 void View::resetView() {
     zoomSlider->setValue(250);
     setupMatrix();
     graphicsView->fitInView(QRectF(0, 0, 3000, 1500));
+    updateChipLayers();
 
     resetButton->setEnabled(false);
 }
@@ -245,9 +325,15 @@ void View::setupMatrix() {
     matrix.scale(scale, -scale);
     
     graphicsView->setMatrix(matrix);
+    updateChipLayers();
     setResetButtonEnabled();
 }
 
+void View::updateChipLayers() {
+    const bool collapsed = detailTier(QStyleOptionGraphicsItem::levelOfDetailFromTransform(graphicsView->transform())) == LAYER_TIER;
+    for (int i = 0; i < chipLayers.size(); i++) chipLayers[i]->setCollapsed(collapsed);
+}
+
 void View::togglePointerMode() {
     graphicsView->setDragMode(selectModeButton->isChecked() ? QGraphicsView::RubberBandDrag : QGraphicsView::ScrollHandDrag);
     graphicsView->setInteractive(selectModeButton->isChecked());
@@ -263,7 +349,10 @@ void View::print() {
     QPrintDialog dialog(&printer, this);
     if (dialog.exec() == QDialog::Accepted) {
         QPainter painter(&printer);
+        // the printer resolution gives another level of detail, so the modules have to paint themselves
+        for (int i = 0; i < chipLayers.size(); i++) chipLayers[i]->setCollapsed(false);
         graphicsView->render(&painter);
+        updateChipLayers();
     }
 #endif
 }
@@ -49,13 +49,18 @@
 #include <QSlider>
 #include <QString>
 #include <QDoubleSpinBox>
+#include <QSet>
 
 #include "TkMapGlobals.h"
 
 QT_FORWARD_DECLARE_CLASS(QLabel)
 QT_FORWARD_DECLARE_CLASS(QToolButton)
+QT_FORWARD_DECLARE_CLASS(QRubberBand)
 
 class View;
+class Chip;
+class ChipIndex;
+class ChipLayer;
 
 /**
  * GraphicsView class
@@ -70,13 +75,18 @@ public:
    * @param[in] v #View class. The #GraphicsView only stores the pointer
    * and does not own the #View.
    */
-  GraphicsView(View *v) : QGraphicsView(), view(v), partition("") { }
+  GraphicsView(View *v) : QGraphicsView(), view(v), partition(""), index(NULL), rubberBand(NULL) { }
   /**
    * draw background using QPainter and using QRectF to set the geometry
    */
   void drawBackground(QPainter *painter, const QRectF &rect);
 
   void setPartition(const QString& part) {partition = part;}   
+  /**
+   * set the spatial index of the modules in the scene, used for the
+   * rubber band selection. The #GraphicsView does not own the index
+   */
+  void setChipIndex(const ChipIndex* idx) { index = idx; }
 
 protected:
     /**
@@ -84,10 +94,21 @@ protected:
      * Qt::ControlModifier is active
      */ 
     void wheelEvent(QWheelEvent *);
+    /**
+     * re-implementing mouse events to run the rubber band selection
+     * on the module index, when there is one
+     */ 
+    void mousePressEvent(QMouseEvent *);
+    void mouseMoveEvent(QMouseEvent *);
+    void mouseReleaseEvent(QMouseEvent *);
 
 private:
     View *view;
     QString partition; 
+    const ChipIndex* index;
+    QRubberBand* rubberBand;
+    QPoint bandOrigin;
+    QSet<Chip*> bandSelection; /*!< modules selected by the current rubber band */
 };
 
 /**
@@ -112,6 +133,19 @@ public:
     void setZoomSliderValue(int value) { zoomSlider->setValue(zoomSlider->value()+value); }
 
     void setPartition(const QString& part) {graphicsView->setPartition(part);}
+    /**
+     * set the spatial index of the modules in the scene
+     */
+    void setChipIndex(const ChipIndex* index) {graphicsView->setChipIndex(index);}
+    /**
+     * set the layers drawing the modules when zoomed out. The #View
+     * does not own the layers
+     */
+    void setChipLayers(const QList<ChipLayer*>& layers) { chipLayers = layers; updateChipLayers(); }
+    /**
+     * set the range of the color scale
+     */
+    void setRange(double minv, double maxv);
  signals:
     /**
      * \deprecated: emitted when inverted() function is called to invert value to state
@@ -196,7 +230,14 @@ private slots:
     void maxChanged() { if(sbMax->value() < sbMin->value() +0.25 ) sbMax->setValue(sbMin->value()+0.25); M::m()->nMax(sbMax->value()); viewUpdate(); }
 
 private:
+    /**
+     * collapse the layers into their images when the view is zoomed
+     * out, to be called whenever the view transformation changes
+     */
+    void updateChipLayers();
+
     GraphicsView *graphicsView;
+    QList<ChipLayer*> chipLayers;
     QLabel *label;
     QLabel *label1;
     QLabel *label2;
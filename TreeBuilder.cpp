@@ -2,13 +2,18 @@
 #include "TreeBuilder.h"
 #include "Debug.h"
 #include "DbConnection.h"
+#include "StripDecoder.h"
+#include "TreeCache.h"
+#include "TreeLoader.h"
 
 #include <stdint.h>
+#include <algorithm>
 
-#include <QApplication>
 #include <QtSql/QSqlError>
+#include <QtSql/QSqlRecord>
 #include <QMessageBox>
 #include <QDate>
+#include <QTime>
 #include <QProgressDialog>
 #include <QThread>
 #include <QFile>
@@ -16,6 +21,7 @@
 #include <QVector>
 #include <QPair>
 #include <QString>
+#include <QStringList>
 
 
 TreeBuilder* TreeBuilder::pInstance = 0;
@@ -26,7 +32,9 @@ TreeBuilder* TreeBuilder::Inst() {
 }
 
 
-TreeBuilder::TreeBuilder() {
+TreeBuilder::TreeBuilder():
+    fillRate_(0.0)
+{
 }
 
 TreeBuilder::~TreeBuilder() {
@@ -105,95 +113,194 @@ bool TreeBuilder::buildTree(const QString& filename, const QString &analysisType
     }
 }
 
-bool TreeBuilder::buildMultiPartTree(const QString& filename, QVector<QRunId> runIds) {
+/** \Class PartitionFetcher
+ *
+ * Worker thread which looks up the latest analysis of one partition and,
+ * if requested, retrieves its result rows on a dedicated database session
+ */
+class PartitionFetcher : public QThread {
+    public:
+        PartitionFetcher(const TreeBuilder::QRunId& runId, const QString& sessionName):
+            QThread(),
+            runId_(runId),
+            sessionName_(sessionName),
+            fetch_(false),
+            result_(false)
+        {
+        }
+
+        /**
+         * also retrieve the rows the next time the thread is started. The
+         * analysis lookup is not repeated once it succeeded. To be called
+         * from the GUI thread, which sets up the column layout since
+         * BaseQuery books ROOT objects
+         */
+        void setFetch(bool fetch) {
+            fetch_ = fetch;
+            if (fetch_) {
+                BaseQuery queryStruct;
+                queryStruct.setExtendedQuery(qPrintable(analysisType_));
+                rows_.setLayout(queryStruct);
+            }
+        }
+
+        const QString& analysisId()   const { return analysisId_;   }
+        const QString& analysisType() const { return analysisType_; }
+        /**
+         * move the fetched rows into buffer, leaving the fetcher empty
+         */
+        void takeRows(ColumnBuffer& buffer) { buffer.swap(rows_); }
+        bool result() const { return result_; }
+
+    protected:
+        void run() {
+            {
+                QSqlDatabase db = DbConnection::Inst()->openSession(sessionName_);
+                result_ = db.isOpen();
+                if (result_ && analysisId_.isEmpty()) result_ = TreeBuilder::Inst()->findAnalysis(db, runId_, analysisId_, analysisType_);
+                if (result_ && fetch_) {
+                    result_ = TreeBuilder::Inst()->fetchRows(db, TreeBuilder::Inst()->getQuery(analysisType_), analysisId_, rows_);
+                }
+            }
+            DbConnection::Inst()->closeSession(sessionName_);
+        }
+
+    private:
+        TreeBuilder::QRunId  runId_;
+        QString              sessionName_;
+        QString              analysisId_;
+        QString              analysisType_;
+        ColumnBuffer         rows_;
+        bool                 fetch_;
+        bool                 result_;
+};
+
+QString TreeBuilder::buildMultiPartTree(const QString& baseName, QVector<QRunId> runIds, bool useCache) {
 
     if (!DbConnection::Inst()->dbConnected()) {
         if(Debug::Inst()->getEnabled()) qDebug() << "DB connection not found ... unable to make the Timing O2O tree ";
-        return false;
+        return "";
     }
 
     if (runIds.size() != 4) {
         if(Debug::Inst()->getEnabled()) qDebug() << "4 runIds needed for the four partitions ... unable to make the Timing O2O tree ";
-        return false;
+        return "";
     }
 
-    bool result=false;
-    QVector<QString> analysisIds; 
-    QVector<QString> analysisTypes; 
+    // Each partition is looked up on its own worker and session 
+    QVector<PartitionFetcher*> fetchers;
     for (int i = 0; i < runIds.size(); i++) {
-        QString myQuery("select max(analysisid), ANALYSISTYPE, RUNNUMBER, PARTITIONNAME");
-        myQuery += " from analysis a join partition b on a.PARTITIONID = b.PARTITIONID";
-        myQuery += " where PARTITIONNAME = ? ";
-        myQuery += " and RUNNUMBER= ?"; 
-        myQuery += " group by ANALYSISTYPE, RUNNUMBER, PARTITIONNAME";                 
-        
-        if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(myQuery);
-        
-        QSqlQuery query;
-        query.prepare(myQuery);
-        query.addBindValue(runIds[i].first);
-        query.addBindValue(runIds[i].second);
-        query.exec();
-        int resultCounter = 0;
+        fetchers.push_back(new PartitionFetcher(runIds[i], QString("MultiPart_%1").arg(i)));
+        fetchers.back()->start();
+    }
 
-        QString analysisId, analysisType;
+    bool result = true;
+    QStringList partitions, runs;
+    QVector<QString> analysisIds; 
+    for (int i = 0; i < fetchers.size(); i++) {
+        fetchers[i]->wait();
+        if (!fetchers[i]->result()) result = false;
+        partitions  << runIds[i].first;
+        runs        << runIds[i].second;
+        analysisIds.push_back(fetchers[i]->analysisId());
+    }
 
-        while (query.next()) {
-            analysisId    = query.value(0).toString();
-            analysisType  = query.value(1).toString() ;
-            resultCounter++;
-        }
-        if( query.lastError().isValid() ) {
-            if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
+    if (!result) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to find analysis IDs for the four partitions ... unable to make the Timing O2O tree ";
+        qDeleteAll(fetchers);
+        return "";
+    }
+
+    QString analysisType = fetchers[0]->analysisType();
+    QString key = TreeCache::Inst()->key(analysisType, partitions.join("*"), runs.join("*"), analysisIds);
+    if (useCache) {
+        QString cached = TreeCache::Inst()->lookup(key);
+        if (!cached.isEmpty()) {
+            qDeleteAll(fetchers);
+            return cached;
         }
-        if (resultCounter==1) result = true;
-        else if (resultCounter>1) {
-            if(Debug::Inst()->getEnabled()) qDebug() << "More than one analysis type on the same run";
-            result =  false;
-        }            
-        else {
-            if(Debug::Inst()->getEnabled()) qDebug()  << "No analysis found for the given run number and partition";
-            result = false;
-        } 
-        if (!result) return false;
+    }
 
-        analysisIds  .push_back(analysisId);
-        analysisTypes.push_back(analysisType);
+    // The rows are fetched in parallel and merged in the order of the run IDs, whatever order the workers finish in
+    for (int i = 0; i < fetchers.size(); i++) {
+        fetchers[i]->setFetch(true);
+        fetchers[i]->start();
     }
 
-    if (analysisIds.size() != 4) {
-        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to find analysis IDs for the four partitions ... unable to make the Timing O2O tree ";
-        return false;
+    // the rows are moved out of the fetchers, the four partitions are the largest load there is
+    QVector<ColumnBuffer> rowSets(fetchers.size());
+    for (int i = 0; i < fetchers.size(); i++) {
+        fetchers[i]->wait();
+        if (!fetchers[i]->result()) result = false;
+        fetchers[i]->takeRows(rowSets[i]);
     }
+    qDeleteAll(fetchers);
 
-    if (analysisTypes.size() != 4) {
-        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to parse run type for all the partitions";
-        return false;
+    if (!result) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to retrieve the analysis results for the four partitions ... unable to make the Timing O2O tree ";
+        return "";
     }
 
     if(Debug::Inst()->getEnabled()) qDebug() << "Creating the file for the Timing O2O tree for all four partitions"; 
     
-    TFile* file = new TFile(qPrintable(filename),"RECREATE");
-    if (!file) {
-        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to create the Timing O2O file: " << qPrintable(filename);
-        return false;
+    QString filename = TreeCache::Inst()->filename(key, baseName + "_FOURPARTS");
+    QString tmpFilename = filename + ".part";
+    TFile* file = new TFile(qPrintable(tmpFilename),"RECREATE");
+    if (!file || file->IsZombie()) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to create the Timing O2O file: " << qPrintable(tmpFilename);
+        delete file;
+        return "";
     }
    
-    std::stringstream myQuery;
-    myQuery << getQuery( qPrintable(analysisTypes[0]) );
     TTree* tree = new TTree("DBTree","DBTree");      
-    fillTree(tree, qPrintable(analysisTypes[0]), myQuery.str(), analysisIds);
+    fillTree(tree, qPrintable(analysisType), rowSets);
     tree->Write();
     file->Close();
     if(Debug::Inst()->getEnabled()) qDebug() << "File recreated";
-    return true;
 
+    if (!TreeCache::Inst()->store(key, tmpFilename, filename)) return "";
+    return filename;
+
+}
+
+bool TreeBuilder::findAnalysis(QSqlDatabase db, const QRunId& runId, QString& analysisId, QString& analysisType) {
+    QString myQuery("select max(analysisid), ANALYSISTYPE, RUNNUMBER, PARTITIONNAME");
+    myQuery += " from analysis a join partition b on a.PARTITIONID = b.PARTITIONID";
+    myQuery += " where PARTITIONNAME = ? ";
+    myQuery += " and RUNNUMBER= ?"; 
+    myQuery += " group by ANALYSISTYPE, RUNNUMBER, PARTITIONNAME";                 
+    
+    if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(myQuery);
+    
+    QSqlQuery query(db);
+    query.prepare(myQuery);
+    query.addBindValue(runId.first);
+    query.addBindValue(runId.second);
+    query.exec();
+    int resultCounter = 0;
+    while (query.next()) {
+        analysisId    = query.value(0).toString();
+        analysisType  = query.value(1).toString() ;
+        resultCounter++;
+    }
+    if( query.lastError().isValid() ) {
+        if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
+    }
+    if (resultCounter==1) return true;
+    else if (resultCounter>1) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "More than one analysis type on the same run";
+        return false;
+    }            
+    else {
+        if(Debug::Inst()->getEnabled()) qDebug()  << "No analysis found for the given run number and partition";
+        return false;
+    } 
 }
 
 QString TreeBuilder::loadAnalysis(const QRunId& pair, bool useCache) {
     if (pair.second == QString::number(sistrip::CURRENTSTATE)) {
         std::stringstream filename;
-        filename << "/opt/cmssw/shifter/avartak/data/" << (QString("CURRENTSTATE_")+pair.first+QString(".root")).toStdString();
+        filename << TreeCache::Inst()->cacheDir().toStdString() << (QString("CURRENTSTATE_")+pair.first+QString(".root")).toStdString();
         bool res = buildTree(filename.str().c_str(), QString::number(sistrip::CURRENTSTATE),QString::number(sistrip::CURRENTSTATE),QRunId(pair.first,QString::number(sistrip::CURRENTSTATE)), true);
         if (Debug::Inst()->getEnabled()) {
             if (res) {
@@ -208,7 +315,7 @@ QString TreeBuilder::loadAnalysis(const QRunId& pair, bool useCache) {
     }
     else if (pair.second == QString::number(sistrip::LASTO2O)) {
         std::stringstream filename;
-        filename << "/opt/cmssw/shifter/avartak/data/" << (QString("LASTO2O_")+pair.first+QString(".root")).toStdString();
+        filename << TreeCache::Inst()->cacheDir().toStdString() << (QString("LASTO2O_")+pair.first+QString(".root")).toStdString();
         bool res = buildTree(filename.str().c_str(), QString::number(sistrip::LASTO2O),QString::number(sistrip::LASTO2O),QRunId(pair.first,QString::number(sistrip::LASTO2O)), true);
         if (Debug::Inst()->getEnabled()) {
             if (res) {
@@ -222,7 +329,6 @@ QString TreeBuilder::loadAnalysis(const QRunId& pair, bool useCache) {
         else return "";
     }
     else if (pair.second == QString::number(sistrip::MULTIPART)) {
-        std::stringstream filename;
         QVector<QRunId> runIds;
         QStringList parts = pair.first.split("*");
         
@@ -243,19 +349,16 @@ QString TreeBuilder::loadAnalysis(const QRunId& pair, bool useCache) {
             runIds.push_back(QRunId(subparts[0], subparts[1]));
         }
 
-        filename << "/opt/cmssw/shifter/avartak/data/" << filenamestart.toStdString() << (QString("_FOURPARTS.root")).toStdString();
-
-        bool res = buildMultiPartTree(filename.str().c_str(), runIds);
+        QString filename = buildMultiPartTree(filenamestart, runIds, useCache);
         if (Debug::Inst()->getEnabled()) {
-            if (res) {
+            if (!filename.isEmpty()) {
                 if(Debug::Inst()->getEnabled()) qDebug() << "Tree build successful for multi-partition view\n";
             }
             else {
                 if(Debug::Inst()->getEnabled()) qDebug() << "Tree build failed for multi-partition view\n";
             }
         }
-        if (res) return QString(filename.str().c_str());
-        else return "";
+        return filename;
     }
 
     bool result=false;
@@ -263,46 +366,23 @@ QString TreeBuilder::loadAnalysis(const QRunId& pair, bool useCache) {
     QString analysisType = "";
     QString analysisId   = "";
     
-    if (DbConnection::Inst()->dbConnected()) {
-        QString myQuery("select max(analysisid), ANALYSISTYPE, RUNNUMBER, PARTITIONNAME");
-        myQuery += " from analysis a join partition b on a.PARTITIONID = b.PARTITIONID";
-        myQuery += " where PARTITIONNAME = ? ";
-        myQuery += " and RUNNUMBER= ?"; 
-        myQuery += " group by ANALYSISTYPE, RUNNUMBER, PARTITIONNAME";                 
-        
-        if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(myQuery);
-        
-        QSqlQuery query;
-        query.prepare(myQuery);
-        query.addBindValue(pair.first);
-        query.addBindValue(pair.second);
-        query.exec();
-        int resultCounter = 0;
-        while (query.next()) {
-            analysisId    = query.value(0).toString();
-            analysisType  = query.value(1).toString() ;
-            resultCounter++;
-        }
-        if( query.lastError().isValid() ) {
-            if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
-        }
-        if (resultCounter==1) result = true;
-        else if (resultCounter>1) {
-            if(Debug::Inst()->getEnabled()) qDebug() << "More than one analysis type on the same run";
-            result =  false;
-        }            
-        else {
-            if(Debug::Inst()->getEnabled()) qDebug()  << "No analysis found for the given run number and partition";
-            result = false;
-        } 
+    if (DbConnection::Inst()->dbConnected()) result = findAnalysis(DbConnection::Inst()->dbConnection(), pair, analysisId, analysisType);
+    if (!result) return "";
+
+    QString key = TreeCache::Inst()->key(analysisType, pair.first, pair.second, QVector<QString>() << analysisId);
+    if (useCache) {
+        QString cached = TreeCache::Inst()->lookup(key);
+        if (!cached.isEmpty()) return cached;
     }
 
-    std::stringstream filename;
-    filename << "/opt/cmssw/shifter/avartak/data/" << analysisType.toStdString() << "_" << pair.first.toStdString() << "_" <<  pair.second.toInt() << "_new.root";
+    // the tree is written to a temporary file first, so that an interrupted build never ends up in the cache
+    QString filename = TreeCache::Inst()->filename(key, QString("%1_%2_%3").arg(analysisType).arg(pair.first).arg(pair.second.toInt()));
+    QString tmpFilename = filename + ".part";
 
-    if(result) result = buildTree(filename.str().c_str(), analysisType, analysisId, pair, useCache);
+    result = buildTree(tmpFilename, analysisType, analysisId, pair, false);
+    if (result) result = TreeCache::Inst()->store(key, tmpFilename, filename);
 
-    if (result) return QString(filename.str().c_str());
+    if (result) return filename;
     else return "";
 }
 
@@ -324,8 +404,101 @@ void TreeBuilder::fillTree(TTree* tree, std::string runType, const std::string&
  
     BaseQuery myQueryStruct2;
     myQueryStruct2.setExtendedQuery(runType);
-      
-    QVector<std::pair<std::string, Base_Type*> >::const_iterator it = myQueryStruct2.query.begin(), itEnd = myQueryStruct2.query.end();    
+    bookBranches(tree, myQueryStruct2);
+
+    ColumnBuffer buffer;
+    buffer.setLayout(myQueryStruct2);
+    buffer.reserve(fetchBlockSize);
+
+    QTime timer;
+    timer.start();
+    size_t nrows = 0;
+
+    for (int k = 0; k < analysisIds.size(); k++) {
+        QSqlQuery query;
+        query.setForwardOnly(true);
+        query.prepare(theQuery.c_str());
+        query.addBindValue(analysisIds[k].toInt());
+        query.exec();
+    
+        while (query.next()) {
+            buffer.read(query);
+            if (buffer.rows == fetchBlockSize) {
+                fillBlock(tree, myQueryStruct2, buffer);
+                nrows += buffer.rows;
+                buffer.clear();
+            }
+        }
+        fillBlock(tree, myQueryStruct2, buffer);
+        nrows += buffer.rows;
+        buffer.clear();
+
+        if( query.lastError().isValid() ) {
+            if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
+        }
+    }
+
+    fillRate_ = nrows * 1000.0 / std::max(timer.elapsed(), 1);
+    if(Debug::Inst()->getEnabled()) qDebug() << "Filled " << nrows << " rows at " << fillRate_ << " rows/s";
+
+    // the branches point into the local query struct, which is gone once we return
+    tree->ResetBranchAddresses();
+}
+
+bool TreeBuilder::fetchRows(QSqlDatabase db, const std::string& theQuery, const QString& analysisId, ColumnBuffer& rows, TreeLoader* loader) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(theQuery.c_str());
+    query.addBindValue(analysisId.toInt());
+    query.exec();
+
+    while (query.next()) {
+        if (rows.rows % fetchBlockSize == 0) rows.reserve(rows.rows + fetchBlockSize);
+        rows.read(query);
+        if (loader) {
+            loader->rowFetched();
+            if (loader->cancelled()) return false;
+        }
+    }
+    if( query.lastError().isValid() ) {
+        if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
+        return false;
+    }
+    return true;
+}
+
+void TreeBuilder::fillTree(TTree* tree, const std::string& runType, const QVector<ColumnBuffer>& rowSets) {
+    if (rowSets.size() == 0) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "No analysis IDs found";
+        return;
+    }
+ 
+    BaseQuery myQueryStruct2;
+    myQueryStruct2.setExtendedQuery(runType);
+    bookBranches(tree, myQueryStruct2);
+
+    QTime timer;
+    timer.start();
+    size_t nrows = 0;
+
+    for (int k = 0; k < rowSets.size(); k++) {
+        if (rowSets[k].fields.size() != static_cast<size_t>(myQueryStruct2.query.size())) {
+            if(Debug::Inst()->getEnabled()) qDebug() << "Result set " << k << " does not match the branch layout of run type " << runType.c_str();
+            continue;
+        }
+        fillBlock(tree, myQueryStruct2, rowSets[k]);
+        nrows += rowSets[k].rows;
+    }
+
+    fillRate_ = nrows * 1000.0 / std::max(timer.elapsed(), 1);
+    if(Debug::Inst()->getEnabled()) qDebug() << "Filled " << nrows << " rows at " << fillRate_ << " rows/s";
+
+    // the branches point into the local query struct, which is gone once we return
+    tree->ResetBranchAddresses();
+}
+
+void TreeBuilder::bookBranches(TTree* tree, const BaseQuery& queryStruct) {
+    QVector<std::pair<std::string, Base_Type*> >::const_iterator it = queryStruct.query.begin(), itEnd = queryStruct.query.end();    
       
     for(; it != itEnd; ++it) {
         const char* branchstr = it->first.c_str();
@@ -350,23 +523,27 @@ void TreeBuilder::fillTree(TTree* tree, std::string runType, const std::string&
             if(Debug::Inst()->getEnabled()) qDebug() << "Unknown branch type";
         }
     }
+}
 
-    for (int k = 0; k < analysisIds.size(); k++) {
-        QSqlQuery query;
-        query.prepare(theQuery.c_str());
-        query.addBindValue(analysisIds[k].toInt());
-        query.exec();
-    
-        while (query.next()) {
-            int i = 0;
-            for(it = myQueryStruct2.query.begin(); it != itEnd; ++it,++i) it->second->setFromResultset(query,i);
-            tree->Fill();
-        }
-        if( query.lastError().isValid() ) {
-            if(Debug::Inst()->getEnabled()) qDebug() << qPrintable(query.lastError().text());
-        }
+void TreeBuilder::fillBlock(TTree* tree, const BaseQuery& queryStruct, const ColumnBuffer& buffer) {
+    // resolve the branch addresses once per block, in the order of the typed columns 
+    std::vector<double*>       doubleTargets;
+    std::vector<unsigned int*> integerTargets;
+    std::vector<String*>       stringTargets;
+    for (int i = 0; i < queryStruct.query.size(); i++) {
+        Base_Type* b = queryStruct.query[i].second;
+        if      (Double*  d = dynamic_cast<Double*> (b)) doubleTargets .push_back(&(d->value));
+        else if (Integer* n = dynamic_cast<Integer*>(b)) integerTargets.push_back(&(n->value));
+        else if (String*  s = dynamic_cast<String*> (b)) stringTargets .push_back(s);
+    }
+
+    const size_t nd = doubleTargets.size(), ni = integerTargets.size(), ns = stringTargets.size();
+    for (size_t r = 0; r < buffer.rows; r++) {
+        for (size_t c = 0; c < nd; c++) *doubleTargets[c]  = buffer.doubles[c][r];
+        for (size_t c = 0; c < ni; c++) *integerTargets[c] = buffer.integers[c][r];
+        for (size_t c = 0; c < ns; c++) stringTargets[c]->set(buffer.strings[c][r]);
+        tree->Fill();
     }
-    
 }
 
 std::string TreeBuilder::getQuery(const QString& analysisType) {
@@ -728,6 +905,17 @@ std::string TreeBuilder::getQuery(const QString& analysisType) {
 
 
 bool TreeBuilder::getState(const QString &partitionName, int state) {
+    if (!DbConnection::Inst()->dbConnected()) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "DB connection not found ... unable to retrieve the state";
+        return false;
+    }
+
+    StateBuffer rows;
+    if (!fetchState(DbConnection::Inst()->dbConnection(), partitionName, state, rows)) return false;
+    return writeState(partitionName, state, rows);
+}
+
+bool TreeBuilder::fetchState(QSqlDatabase db, const QString &partitionName, int state, StateBuffer& rows, TreeLoader* loader) {
     if ( state == sistrip::CURRENTSTATE ) {
         if(Debug::Inst()->getEnabled()) qDebug() << "Creating tree from current state";
     }            
@@ -750,7 +938,7 @@ bool TreeBuilder::getState(const QString &partitionName, int state) {
         QString("\' and dcu.versionmajorid=d.fecversionmajorid and dcu.versionminorid=d.fecversionminorid join dcuinfo e on e.versionmajorid = d.dcuinfoversionmajorid and e.versionminorid= d.dcuinfoversionminorid and e.dcuhardid=dcu.dcuhardid and a.i2caddress in ( 32,33,34,35,36,37 ) order by detid, i2caddress")
     );
 
-    QSqlQuery devquery;
+    QSqlQuery devquery(db);
     devquery.prepare(devmapstr);
     devquery.exec();
    
@@ -763,18 +951,14 @@ bool TreeBuilder::getState(const QString &partitionName, int state) {
     
         devmap[devid] = QPair<unsigned int, int>(detid, i2cad);
     }
+    if (loader && loader->cancelled()) return false;
 
     QString currentState("with mypartition as ( select ? name from dual), myvalues as ( select fed.id fedid, fefpga.id feunit, channel.id fechan,apvfed.id apvfed, VALUE  from strip join apvfed on apvid=deviceid join channel using(channelid) join channelpair using(channelpairid) join fefpga using(fefpgaid) join fed using(fedid) join viewcurrentstate a on a.partitionname=( select name from mypartition) and a.partitionid=fed.partitionid and strip.versionmajorid=a.fedversionmajorid and apvid not in ( select deviceid from fedmaskdevice a join viewcurrentstate b on a.VERSIONMAJORID=b.MASKVERSIONMAJORID and a.VERSIONMINORID=b.MASKVERSIONMINORID) ), myconnections as ( select distinct FEDID, FEUNIT, FECHAN, DEVICEID, i2caddress, i2cchannel, ccuaddress, ringslot, fecslot, crateslot, CRATESLOT*power(2,27)+FECSLOT*power(2,22)+RINGSLOT*power(2,18)+CCUADDRESS*power(2,10)+I2CCHANNEL*power(2,5)+((ROUND((I2CADDRESS-.5)/2)-16)+1)*power(2,2)+(case when Mod(I2CADDRESS,2) = 0 then 1 else 2 end) FecKey from ANALYSISFASTFEDCABLING join analysis using(analysisid) join viewcurrentstate using(partitionid) join viewdevice using(deviceid) where viewdevice.partitionname=(select name from mypartition)  ) select myvalues.fedid fedid, myvalues.feunit feunit, myvalues.fechan fechan, myvalues.apvfed feapv, myconnections.deviceid, i2caddress,i2cchannel,ccuaddress,ringslot, fecslot, feckey , value from myvalues inner join myconnections on myvalues.fedid=myconnections.fedid and myvalues.feunit=myconnections.feunit and myvalues.fechan=myconnections.fechan and mod(APVFED,2) <> mod(I2CADDRESS,2) and value is not null order by myvalues.fedid,myvalues.feunit, myvalues.fechan");
     
     QString lastO2O("with mypartition as ( select ? name from dual), myvalues as ( select fed.id fedid, fefpga.id feunit, channel.id fechan,apvfed.id apvfed, VALUE  from strip join apvfed on apvid=deviceid join channel using(channelid) join channelpair using(channelpairid) join fefpga using(fefpgaid) join fed using(fedid) join VIEWLASTO2OPARTITIONS a on a.partitionname=( select name from mypartition) and a.partitionid=fed.partitionid and strip.versionmajorid=a.fedversionmajorid and apvid not in ( select deviceid from fedmaskdevice a join VIEWLASTO2OPARTITIONS b on a.VERSIONMAJORID=b.MASKVERSIONMAJORID and a.VERSIONMINORID=b.MASKVERSIONMINORID) ), myconnections as ( select distinct FEDID, FEUNIT, FECHAN, DEVICEID, i2caddress, i2cchannel, ccuaddress, ringslot, fecslot, crateslot, CRATESLOT*power(2,27)+FECSLOT*power(2,22)+RINGSLOT*power(2,18)+CCUADDRESS*power(2,10)+I2CCHANNEL*power(2,5)+((ROUND((I2CADDRESS-.5)/2)-16)+1)*power(2,2)+(case when Mod(I2CADDRESS,2) = 0 then 1 else 2 end) FecKey from ANALYSISFASTFEDCABLING join analysis using(analysisid) join VIEWLASTO2OPARTITIONS using(partitionid) join viewdevice using(deviceid) where viewdevice.partitionname=(select name from mypartition)  ) select myvalues.fedid fedid, myvalues.feunit feunit, myvalues.fechan fechan, myvalues.apvfed feapv, myconnections.deviceid, i2caddress,i2cchannel,ccuaddress,ringslot, fecslot, feckey , value from myvalues inner join myconnections on myvalues.fedid=myconnections.fedid and myvalues.feunit=myconnections.feunit and myvalues.fechan=myconnections.fechan and mod(APVFED,2) <> mod(I2CADDRESS,2) and value is not null order by myvalues.fedid,myvalues.feunit, myvalues.fechan");
     
-    
-    double FedId, FeUnit, FeChan, FeApv, DeviceId, Fec, Ring, Ccu, I2CChannel,I2CAddress, Detid, PedsMean, NoiseMean;
-    uint32_t FecKey;
-    Double_t Noise[128];
-    Double_t Pedestal[128];
-    
-    QSqlQuery getClob;
+    QSqlQuery getClob(db);
+    getClob.setForwardOnly(true);
     if ( state == sistrip::CURRENTSTATE ) getClob.prepare(currentState);
     else getClob.prepare(lastO2O);
 
@@ -786,14 +970,67 @@ bool TreeBuilder::getState(const QString &partitionName, int state) {
         return false;
     }
     
-    if(Debug::Inst()->getEnabled()) qDebug() << "Query done, now booking tree....";
+    if(Debug::Inst()->getEnabled()) qDebug() << "Query done, now retrieving results";
+    
+    while (getClob.next()) {
+        if (rows.rows % fetchBlockSize == 0) rows.reserve(rows.rows + fetchBlockSize);
+
+        double values[StateBuffer::nColumns];
+        values[StateBuffer::FEDID]      = getClob.value(0).toDouble();
+        values[StateBuffer::FEUNIT]     = getClob.value(1).toDouble();
+        values[StateBuffer::FECHAN]     = getClob.value(2).toDouble();
+        values[StateBuffer::FEAPV]      = getClob.value(3).toDouble();
+        values[StateBuffer::DEVICEID]   = getClob.value(4).toDouble();
+        values[StateBuffer::I2CADDRESS] = getClob.value(5).toDouble();
+        values[StateBuffer::I2CCHANNEL] = getClob.value(6).toDouble();
+        values[StateBuffer::CCU]        = getClob.value(7).toDouble();
+        values[StateBuffer::RING]       = getClob.value(8).toDouble();
+        values[StateBuffer::FEC]        = getClob.value(9).toDouble();
+        values[StateBuffer::DETID]      = double(devmap[getClob.value(4).toUInt()].first);
+        rows.values.insert(rows.values.end(), values, values + StateBuffer::nColumns);
+        rows.fecKeys.push_back(getClob.value(10).toUInt());
+
+        rows.noise.resize(rows.noise.size() + StripDecoder::nStrips);
+        rows.pedestal.resize(rows.pedestal.size() + StripDecoder::nStrips);
+        QByteArray clob = getClob.value(11).toByteArray();
+        int nword = StripDecoder::decode(clob.constData(), clob.size(), &rows.noise[rows.rows * StripDecoder::nStrips], &rows.pedestal[rows.rows * StripDecoder::nStrips]);
+        if (nword > StripDecoder::nStrips) {
+            if(Debug::Inst()->getEnabled()) qDebug() << "Found " << nword << " strips for device " << values[StateBuffer::DEVICEID] << ", only the first " << StripDecoder::nStrips << " are filled";
+        }
+        rows.rows++;
+
+        if (loader) {
+            loader->rowFetched();
+            if (loader->cancelled()) return false;
+        }
+    }
+    if ( getClob.lastError().isValid() ) {
+        if(Debug::Inst()->getEnabled()) qDebug() << getClob.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool TreeBuilder::writeState(const QString &partitionName, int state, const StateBuffer& rows) {
+    double FedId, FeUnit, FeChan, FeApv, DeviceId, Fec, Ring, Ccu, I2CChannel,I2CAddress, Detid, PedsMean, NoiseMean;
+    uint32_t FecKey;
+    Double_t Noise[128];
+    Double_t Pedestal[128];
     
-    QString path = "/opt/cmssw/shifter/avartak/data/";
+    QString path = TreeCache::Inst()->cacheDir();
     
     QString name = QString("CURRENTSTATE_")+partitionName;
     if (state == sistrip::LASTO2O) name = QString("LASTO2O_")+partitionName;
     
-    TFile *file = new TFile(qPrintable(path+name+QString(".root")),"RECREATE");
+    // written next to the final file first, so that a failed write never replaces the last good state
+    QString filename = path+name+QString(".root");
+    QString tmpFilename = filename + ".part";
+    TFile *file = new TFile(qPrintable(tmpFilename),"RECREATE");
+    if (!file || file->IsZombie()) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to create the state file: " << qPrintable(tmpFilename);
+        delete file;
+        return false;
+    }
     TTree *tree = new TTree("DBTree","Tree with DB state");
     
     tree->Branch("FedId",&FedId);
@@ -813,46 +1050,25 @@ bool TreeBuilder::getState(const QString &partitionName, int state) {
     tree->Branch("NoiseMean",&NoiseMean);
     tree->Branch("FecKey",&FecKey);
     
-    if(Debug::Inst()->getEnabled()) qDebug() << "Tree booked, now retrieving results";
+    if(Debug::Inst()->getEnabled()) qDebug() << "Tree booked, now filling " << rows.rows << " rows";
     
-    int count = 0;
-    while (getClob.next()) {
-        count++;
-        
-        if ( count % 100 == 0 ) QApplication::processEvents();
-        
-        FedId      = getClob.value(0).toDouble();
-        FeUnit     = getClob.value(1).toDouble();
-        FeChan     = getClob.value(2).toDouble();
-        FeApv      = getClob.value(3).toDouble();
-        DeviceId   = getClob.value(4).toDouble();
-        I2CAddress = getClob.value(5).toDouble();
-        I2CChannel = getClob.value(6).toDouble();
-        Ccu        = getClob.value(7).toDouble();
-        Ring       = getClob.value(8).toDouble();
-        Fec        = getClob.value(9).toDouble();
-        FecKey     = getClob.value(10).toUInt();
-        Detid      = double(devmap[getClob.value(4).toUInt()].first);
-
-        QByteArray array = QByteArray::fromBase64 (getClob.value(11).toByteArray()).toHex();
-        int index = 0;
-        for( int i = 0; i < array.size(); i+=8, ++index ) {
-            QByteArray mystrip = array.mid(i,8);
-            QByteArray mystrip2;
-            for( int k = mystrip.size(); k >= 0; k-=2 ) mystrip2 += mystrip.mid(k,2);
-            bool ok;
-            long strip = mystrip2.toLong(&ok,16);
-            float noise   = static_cast<float>    ( ( strip >> 13 ) & 0x000001FF ) / 10.0;
-            uint16_t ped  = static_cast<uint16_t> ( ( strip >> 22 ) & 0x000003FF );
-          
-            if ( index < 128 ) {
-                Noise[index] = noise;
-                Pedestal[index] = ped;
-            } 
-            else {
-                if(Debug::Inst()->getEnabled()) qDebug() << "Would try to fill strip " << strip << " and will not do it!";
-            }
-        }
+    for (size_t r = 0; r < rows.rows; r++) {
+        const double* values = &rows.values[r * StateBuffer::nColumns];
+        FedId      = values[StateBuffer::FEDID];
+        FeUnit     = values[StateBuffer::FEUNIT];
+        FeChan     = values[StateBuffer::FECHAN];
+        FeApv      = values[StateBuffer::FEAPV];
+        DeviceId   = values[StateBuffer::DEVICEID];
+        I2CAddress = values[StateBuffer::I2CADDRESS];
+        I2CChannel = values[StateBuffer::I2CCHANNEL];
+        Ccu        = values[StateBuffer::CCU];
+        Ring       = values[StateBuffer::RING];
+        Fec        = values[StateBuffer::FEC];
+        Detid      = values[StateBuffer::DETID];
+        FecKey     = rows.fecKeys[r];
+
+        std::copy(&rows.noise[r * StripDecoder::nStrips],    &rows.noise[r * StripDecoder::nStrips]    + StripDecoder::nStrips, Noise);
+        std::copy(&rows.pedestal[r * StripDecoder::nStrips], &rows.pedestal[r * StripDecoder::nStrips] + StripDecoder::nStrips, Pedestal);
         PedsMean  = 0.0;
         NoiseMean = 0.0;
         for (int i = 0; i < 128; i++) {
@@ -867,8 +1083,32 @@ bool TreeBuilder::getState(const QString &partitionName, int state) {
     if(Debug::Inst()->getEnabled()) qDebug() << "Done filling, writing results";
     file->Write();
     file->Close();
+
+    if (QFile::exists(filename)) QFile::remove(filename);
+    if (!QFile::rename(tmpFilename, filename)) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to move " << qPrintable(tmpFilename) << " to " << qPrintable(filename);
+        QFile::remove(tmpFilename);
+        return false;
+    }
     
-    return buildTree(path+name+QString(".root"),QString::number(state),QString::number(state),QRunId(partitionName,QString::number(state)),true);
+    return buildTree(filename,QString::number(state),QString::number(state),QRunId(partitionName,QString::number(state)),true);
+}
+
+QString TreeBuilder::writeAnalysis(const QRunId& runId, const QString& analysisType, const QString& key, const ColumnBuffer& rows) {
+    QString filename = TreeCache::Inst()->filename(key, QString("%1_%2_%3").arg(analysisType).arg(runId.first).arg(runId.second.toInt()));
+    QString tmpFilename = filename + ".part";
+    TFile* file = new TFile(qPrintable(tmpFilename),"RECREATE");
+    if (!file || file->IsZombie()) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to create the analysis file: " << qPrintable(tmpFilename);
+        delete file;
+        return "";
+    }
+
+    TTree* tree = new TTree("DBTree","DBTree");      
+    fillTree(tree, qPrintable(analysisType), QVector<ColumnBuffer>() << rows);
+    tree->Write();
+    file->Close();
 
-  
+    if (!TreeCache::Inst()->store(key, tmpFilename, filename)) return "";
+    return filename;
 }
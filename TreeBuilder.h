@@ -5,7 +5,17 @@
 #include <TFile.h>
 #include <iostream>
 #include <sstream>
+#include <QtSql/QSqlDatabase>
+#include <QPair>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <vector>
+#include <stdint.h>
 #include "BaseTypes.h"
+#include "StripDecoder.h"
+
+class TreeLoader;
 
 // copying enum from CMSSW in order to not have any specific
 // dependency. 
@@ -43,6 +53,39 @@ namespace sistrip {
 }
 
 
+/** \Struct StateBuffer
+ *
+ * struct to hold the decoded rows of a partition state, as retrieved by
+ * TreeBuilder::fetchState. The noise and pedestal values are stored
+ * flat, StripDecoder::nStrips of them per row
+ */
+struct StateBuffer {
+
+    enum Column { FEDID, FEUNIT, FECHAN, FEAPV, DEVICEID, I2CADDRESS, I2CCHANNEL, CCU, RING, FEC, DETID, nColumns };
+
+    std::vector<double>   values;   /**< nColumns values per row */
+    std::vector<uint32_t> fecKeys;
+    std::vector<double>   noise;
+    std::vector<double>   pedestal;
+    size_t rows;
+
+    StateBuffer():
+        rows(0)
+    {
+    }
+
+    /**
+     * reserve space for n rows in every column
+     */
+    void reserve(size_t n) {
+        values  .reserve(n * nColumns);
+        fecKeys .reserve(n);
+        noise   .reserve(n * StripDecoder::nStrips);
+        pedestal.reserve(n * StripDecoder::nStrips);
+    }
+};
+
+
 /** \Class TreeBuilder 
  * 
  * Singleton class to provide single source to access trees to
@@ -50,6 +93,9 @@ namespace sistrip {
  *
  */ 
 class TreeBuilder {
+    friend class PartitionFetcher;
+    friend class TreeLoader;
+
     public:
         typedef QPair<QString,QString> QRunId; /**< unique ID of a run consisting of partition name and run number */
         
@@ -82,9 +128,10 @@ class TreeBuilder {
         bool    buildTree(const QString& filename, const QString &analysisType, const QString &analysisId, const QString &partitionName, const QString &runNumber, bool useCache=false);
         /**
          * Create a file with a tree for timing runs corresponding to all the four partitions
-         * These timing runs are to be used for the timing O2O
+         * These timing runs are to be used for the timing O2O. Returns the
+         * path of the file or an empty string on failure
          */ 
-        bool    buildMultiPartTree(const QString& filename, QVector<QRunId> runIds);
+        QString buildMultiPartTree(const QString& baseName, QVector<QRunId> runIds, bool useCache=false);
         /**
          * load analysis for a given run number and partition.
          */
@@ -100,6 +147,12 @@ class TreeBuilder {
          */ 
         bool getState(const QString &partitionName, int state);
 
+        /**
+         * number of rows per second retrieved and filled into the tree by
+         * the last tree build
+         */ 
+        double fillRate() const { return fillRate_; }
+
         
     protected:
         TreeBuilder();
@@ -118,6 +171,53 @@ class TreeBuilder {
          * query used to retrieve the data is passed as argument.
          */
         void fillTree(TTree* tree, std::string runType, const std::string& theQuery, QVector<QString> analysisIds);
+        /**
+         * Book the branches for a given run type and fill the tree from
+         * result sets which were already retrieved. The result sets are
+         * filled in the order in which they are given
+         */
+        void fillTree(TTree* tree, const std::string& runType, const QVector<ColumnBuffer>& rowSets);
+        /**
+         * book one branch per field of the query
+         */
+        void bookBranches(TTree* tree, const BaseQuery& queryStruct);
+        /**
+         * copy the rows of a buffer into the branches of the query and
+         * fill the tree once per row
+         */
+        void fillBlock(TTree* tree, const BaseQuery& queryStruct, const ColumnBuffer& buffer);
+        /**
+         * find the latest analysis ID and the analysis type of a run using
+         * the given database session. Reports the success/non success of
+         * this operation
+         */ 
+        bool findAnalysis(QSqlDatabase db, const QRunId& runId, QString& analysisId, QString& analysisType);
+        /**
+         * run the query for a given analysis ID on the given database
+         * session and store the result rows. If a loader is given, the
+         * rows are counted on it and the retrieval stops once it is
+         * cancelled
+         */ 
+        bool fetchRows(QSqlDatabase db, const std::string& theQuery, const QString& analysisId, ColumnBuffer& rows, TreeLoader* loader = 0);
+        /**
+         * write the rows of an analysis to a new file and store it in the
+         * #TreeCache under the key. Returns the path of the file or an
+         * empty string on failure
+         */ 
+        QString writeAnalysis(const QRunId& runId, const QString& analysisType, const QString& key, const ColumnBuffer& rows);
+        /**
+         * retrieve and decode the FED values of a partition state using
+         * the given database session. If a loader is given, the rows are
+         * counted on it and the retrieval stops once it is cancelled
+         */ 
+        bool fetchState(QSqlDatabase db, const QString &partitionName, int state, StateBuffer& rows, TreeLoader* loader = 0);
+        /**
+         * write the tree of a partition state retrieved by fetchState
+         */ 
+        bool writeState(const QString &partitionName, int state, const StateBuffer& rows);
+
+        static const size_t fetchBlockSize = 5000; /**< number of rows copied into the branches at a time */
+        double fillRate_;                          /**< rows per second achieved by the last call of fillTree */
         /**
          * get the query to retrieve information for a given run type and a
          * given analysis id
@@ -0,0 +1,214 @@
+#include "TreeCache.h"
+#include "Debug.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+
+TreeCache* TreeCache::pInstance = 0;
+
+TreeCache* TreeCache::Inst() {
+    if(pInstance == 0) pInstance = new TreeCache();
+    return pInstance;
+}
+
+TreeCache::TreeCache():
+    cacheDir_("/opt/cmssw/shifter/avartak/data/"),
+    maxSize_(Q_INT64_C(20000000000)),
+    loaded_(false),
+    dirty_(false),
+    mutex_(QMutex::Recursive)
+{
+}
+
+void TreeCache::setCacheDir(const QString& dir) {
+    QMutexLocker lock(&mutex_);
+    cacheDir_ = dir.endsWith("/") ? dir : dir + "/";
+    entries_.clear();
+    loaded_ = false;
+}
+
+QString TreeCache::cacheDir() const {
+    QMutexLocker lock(&mutex_);
+    return cacheDir_;
+}
+
+void TreeCache::setMaxSize(qint64 bytes) {
+    QMutexLocker lock(&mutex_);
+    maxSize_ = bytes;
+}
+
+qint64 TreeCache::maxSize() const {
+    QMutexLocker lock(&mutex_);
+    return maxSize_;
+}
+
+QString TreeCache::key(const QString& runType, const QString& partition, const QString& run, QVector<QString> analysisIds) const {
+    QStringList ids;
+    for (int i = 0; i < analysisIds.size(); i++) ids << analysisIds[i];
+    return QString("%1|%2|%3|%4|v%5").arg(runType).arg(partition).arg(run).arg(ids.join(",")).arg(schemaVersion);
+}
+
+QString TreeCache::indexFile() const {
+    return cacheDir_ + "treecache.idx";
+}
+
+QString TreeCache::filename(const QString& key, const QString& baseName) const {
+    QMutexLocker lock(&mutex_);
+    QByteArray hash = QCryptographicHash::hash(key.toLatin1(), QCryptographicHash::Md5).toHex().left(8);
+    return cacheDir_ + baseName + "_" + QString(hash) + ".root";
+}
+
+QByteArray TreeCache::checksum(const QString& file) const {
+    QFile qf(file);
+    if (!qf.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while (!qf.atEnd()) hash.addData(qf.read(1 << 20));
+    return hash.result().toHex();
+}
+
+void TreeCache::load() {
+    if (loaded_) return;
+    loaded_ = true;
+    entries_.clear();
+
+    QFile qf(indexFile());
+    if (!qf.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+    QTextStream in(&qf);
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split("\t");
+        // indices written before the modification time was recorded have 5 fields, their files get checked once
+        if (fields.size() != 5 && fields.size() != 6) continue;
+        Entry entry;
+        entry.file     = fields[1];
+        entry.size     = fields[2].toLongLong();
+        entry.checksum = fields[3].toLatin1();
+        entry.lastUsed = fields[4].toUInt();
+        entry.modified = fields.size() == 6 ? fields[5].toUInt() : 0;
+        entry.verified = false;
+        entries_[fields[0]] = entry;
+    }
+    if(Debug::Inst()->getEnabled()) qDebug() << "Read " << entries_.size() << " entries from the tree cache index " << qPrintable(indexFile());
+}
+
+void TreeCache::save() {
+    QDir().mkpath(cacheDir_);
+    QString tmpIndex = indexFile() + ".tmp";
+    QFile qf(tmpIndex);
+    if (!qf.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to write the tree cache index " << qPrintable(tmpIndex);
+        return;
+    }
+    QTextStream out(&qf);
+    for (QMap<QString, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        out << it.key() << "\t" << it->file << "\t" << it->size << "\t" << it->checksum << "\t" << it->lastUsed << "\t" << it->modified << "\n";
+    }
+    out.flush();
+    qf.close();
+    QFile::remove(indexFile());
+    QFile::rename(tmpIndex, indexFile());
+    dirty_ = false;
+}
+
+void TreeCache::flush() {
+    QMutexLocker lock(&mutex_);
+    if (dirty_) save();
+}
+
+QString TreeCache::lookup(const QString& key) {
+    QMutexLocker lock(&mutex_);
+    load();
+    QMap<QString, Entry>::iterator it = entries_.find(key);
+    if (it == entries_.end()) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "No cached tree for " << qPrintable(key);
+        return "";
+    }
+
+    // the checksum is compared once per session, and again if the file was touched since
+    QFileInfo info(it->file);
+    uint modified = info.lastModified().toTime_t();
+    bool valid = info.exists() && info.size() == it->size;
+    if (valid && (!it->verified || modified != it->modified)) {
+        valid = checksum(it->file) == it->checksum;
+        if (valid) {
+            it->modified = modified;
+            it->verified = true;
+        }
+    }
+    if (!valid) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Cached tree " << qPrintable(it->file) << " is stale or incomplete, dropping it";
+        remove(key);
+        return "";
+    }
+
+    // written to the index with the next store or removal, or at exit
+    it->lastUsed = QDateTime::currentDateTime().toTime_t();
+    dirty_ = true;
+    if(Debug::Inst()->getEnabled()) qDebug() << "Using cached tree " << qPrintable(it->file);
+    return it->file;
+}
+
+bool TreeCache::store(const QString& key, const QString& tmpFile, const QString& file) {
+    QMutexLocker lock(&mutex_);
+    load();
+    if (QFile::exists(file)) QFile::remove(file);
+    if (!QFile::rename(tmpFile, file)) {
+        if(Debug::Inst()->getEnabled()) qDebug() << "Unable to move " << qPrintable(tmpFile) << " to " << qPrintable(file);
+        QFile::remove(tmpFile);
+        return false;
+    }
+
+    // other keys pointing to the same file are no longer valid
+    for (QMap<QString, Entry>::iterator it = entries_.begin(); it != entries_.end(); ) {
+        if (it->file == file && it.key() != key) it = entries_.erase(it);
+        else ++it;
+    }
+
+    Entry entry;
+    entry.file     = file;
+    entry.size     = QFileInfo(file).size();
+    entry.checksum = checksum(file);
+    entry.modified = QFileInfo(file).lastModified().toTime_t();
+    entry.verified = true;
+    entry.lastUsed = QDateTime::currentDateTime().toTime_t();
+    entries_[key]  = entry;
+
+    evict(key);
+    save();
+    return true;
+}
+
+void TreeCache::remove(const QString& key) {
+    QMutexLocker lock(&mutex_);
+    load();
+    QMap<QString, Entry>::iterator it = entries_.find(key);
+    if (it == entries_.end()) return;
+    QFile::remove(it->file);
+    entries_.erase(it);
+    save();
+}
+
+void TreeCache::evict(const QString& keep) {
+    qint64 total = 0;
+    QVector<QPair<uint, QString> > byAge;
+    for (QMap<QString, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it) {
+        total += it->size;
+        if (it.key() != keep) byAge.push_back(qMakePair(it->lastUsed, it.key()));
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    for (int i = 0; i < byAge.size() && total > maxSize_; i++) {
+        QMap<QString, Entry>::iterator it = entries_.find(byAge[i].second);
+        if(Debug::Inst()->getEnabled()) qDebug() << "Evicting cached tree " << qPrintable(it->file);
+        total -= it->size;
+        QFile::remove(it->file);
+        entries_.erase(it);
+    }
+}
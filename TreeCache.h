@@ -0,0 +1,113 @@
+#ifndef TREECACHE_H
+#define TREECACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+#include <QMutex>
+
+/** \Class TreeCache
+ *
+ * \brief Singleton class managing the ROOT files with analysis trees
+ * written by #TreeBuilder
+ *
+ * Every file is registered in an index kept in the cache directory. The
+ * index is keyed by run type, partition, run number, the list of
+ * analysis IDs and the schema version of the tree layout. A file is
+ * only served if its size and content checksum still match the values
+ * recorded when it was written. The checksum is compared on the first
+ * hit of a session and again whenever the modification time of the file
+ * has changed. When the total size of the cache goes beyond the limit,
+ * the least recently used files are deleted. The access times are
+ * written to the index with the next store or removal, or by #flush at
+ * exit. The index is guarded by a mutex, since trees are looked up from
+ * the #TreeLoader worker as well as from the GUI thread.
+ */ 
+class TreeCache {
+    public:
+        static const int schemaVersion = 2; /**< to be increased whenever the branch layout written by TreeBuilder changes */
+
+        /**
+         * return static instance of this class
+         */
+        static TreeCache* Inst();
+        
+        /**
+         * set the directory holding the cached files and the index. The
+         * index of the new directory is read the next time it is needed
+         */ 
+        void setCacheDir(const QString& dir);
+        QString cacheDir() const;
+
+        /**
+         * set the maximum total size of the cached files in bytes
+         */ 
+        void setMaxSize(qint64 bytes);
+        qint64 maxSize() const;
+
+        /**
+         * build the index key of a tree
+         */ 
+        QString key(const QString& runType, const QString& partition, const QString& run, QVector<QString> analysisIds) const;
+
+        /**
+         * return the path of a valid cached file for the key or an empty
+         * string. Entries whose file is missing, whose size differs or
+         * whose checksum does not match after the file was modified are
+         * dropped from the index
+         */ 
+        QString lookup(const QString& key);
+
+        /**
+         * return the path under which the file for the key is to be
+         * stored. The name starts with the given readable base name
+         */ 
+        QString filename(const QString& key, const QString& baseName) const;
+
+        /**
+         * move a completely written file to its final path and register
+         * it in the index under the key. Evicts old files if needed
+         */ 
+        bool store(const QString& key, const QString& tmpFile, const QString& file);
+
+        /**
+         * drop the entry for the key and delete its file
+         */ 
+        void remove(const QString& key);
+
+        /**
+         * write the access times of the lookups since the last store or
+         * removal to the index, to be called at exit
+         */ 
+        void flush();
+
+    protected:
+        TreeCache();
+
+    private:
+        struct Entry {
+            QString    file;
+            qint64     size;
+            QByteArray checksum;
+            uint       modified;
+            uint       lastUsed;
+            bool       verified; /**< checksum compared in this session, not written to the index */
+        };
+
+        static TreeCache* pInstance;
+        QString cacheDir_;
+        qint64  maxSize_;
+        bool    loaded_;
+        bool    dirty_;
+        QMap<QString, Entry> entries_;
+        mutable QMutex mutex_;
+
+        QString    indexFile() const;
+        QByteArray checksum(const QString& file) const;
+        void load();
+        void save();
+        void evict(const QString& keep);
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "TreeLoader.h"
+#include "TreeCache.h"
+#include "DbConnection.h"
+#include "Debug.h"
+
+namespace {
+    // a cancelled loader may still be waiting for the database when the next one starts
+    int nLoaders = 0;
+}
+
+TreeLoader::TreeLoader(const TreeBuilder::QRunId& runId, bool useCache, QObject* parent):
+    QThread(parent),
+    runId_(runId),
+    useCache_(useCache),
+    result_(false),
+    sessionName_(QString("TreeLoader_%1").arg(nLoaders++)),
+    cancelled_(0),
+    nRows_(0)
+{
+    // BaseQuery books ROOT objects, the worker only picks the layout of its analysis type
+    QStringList runTypes = BaseQuery::extendedTypes() << "";
+    for (int i = 0; i < runTypes.size(); i++) {
+        BaseQuery queryStruct;
+        queryStruct.setExtendedQuery(qPrintable(runTypes[i]));
+        layouts_[runTypes[i]].setLayout(queryStruct);
+    }
+}
+
+bool TreeLoader::isState() const {
+    return runId_.second == QString::number(sistrip::CURRENTSTATE) || runId_.second == QString::number(sistrip::LASTO2O);
+}
+
+void TreeLoader::rowFetched() {
+    int rows = nRows_.fetchAndAddRelaxed(1) + 1;
+    if (rows % progressStep == 0) emit progress(rows);
+}
+
+void TreeLoader::run() {
+    {
+        QSqlDatabase db = DbConnection::Inst()->openSession(sessionName_);
+        result_ = db.isOpen();
+        if (result_ && isState()) {
+            result_ = TreeBuilder::Inst()->fetchState(db, runId_.first, runId_.second.toInt(), stateRows_, this);
+        }
+        else if (result_) {
+            result_ = TreeBuilder::Inst()->findAnalysis(db, runId_, analysisId_, analysisType_);
+            if (result_) {
+                key_ = TreeCache::Inst()->key(analysisType_, runId_.first, runId_.second, QVector<QString>() << analysisId_);
+                if (useCache_) cachedFile_ = TreeCache::Inst()->lookup(key_);
+            }
+            if (result_ && cachedFile_.isEmpty() && !cancelled()) {
+                rows_ = layouts_.value(analysisType_, layouts_.value(""));
+                result_ = TreeBuilder::Inst()->fetchRows(db, TreeBuilder::Inst()->getQuery(analysisType_), analysisId_, rows_, this);
+            }
+        }
+    }
+    DbConnection::Inst()->closeSession(sessionName_);
+    if (Debug::Inst()->getEnabled()) qDebug() << "Fetched " << nRows() << " rows for " << qPrintable(runId_.first) << ":" << qPrintable(runId_.second) << (cancelled() ? " before being cancelled" : "");
+}
+
+QString TreeLoader::finish() {
+    if (!result_ || cancelled()) return "";
+
+    if (isState()) {
+        if (!TreeBuilder::Inst()->writeState(runId_.first, runId_.second.toInt(), stateRows_)) return "";
+        return TreeBuilder::Inst()->loadAnalysis(runId_);
+    }
+
+    if (!cachedFile_.isEmpty()) return cachedFile_;
+    return TreeBuilder::Inst()->writeAnalysis(runId_, analysisType_, key_, rows_);
+}
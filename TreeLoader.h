@@ -0,0 +1,92 @@
+#ifndef TREELOADER_H
+#define TREELOADER_H
+
+// Qt includes
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+#include <QMap>
+
+// project includes
+#include "TreeBuilder.h"
+
+/** \Class TreeLoader
+ *
+ * \brief Worker thread retrieving an analysis or a partition state for
+ * the #TreeBuilder without blocking the GUI
+ *
+ * The database part of TreeBuilder::loadAnalysis and
+ * TreeBuilder::getState runs on the worker, on a session of its own,
+ * while the GUI thread keeps serving events. The number of rows fetched
+ * so far is reported by the #progress signal and the worker checks for
+ * cancellation after every row. Since ROOT is only used from the GUI
+ * thread, the tree is written by #finish once the worker is done, so a
+ * cancelled or failed load never leaves a file in the cache. For the same
+ * reason the column layouts of all run types are set up by the
+ * constructor, as the analysis type is only known on the worker.
+ */
+class TreeLoader : public QThread {
+
+    Q_OBJECT
+
+    friend class TreeBuilder;
+
+    public:
+        static const int progressStep = 500; /**< number of rows between two progress signals */
+
+        /**
+         * load the analysis of a run, or the current or last O2O'ed state
+         * if the run number is sistrip::CURRENTSTATE or sistrip::LASTO2O
+         */
+        TreeLoader(const TreeBuilder::QRunId& runId, bool useCache = false, QObject* parent = 0);
+
+        const TreeBuilder::QRunId& runId() const { return runId_; }
+        bool useCache() const { return useCache_; }
+
+        /**
+         * ask the worker to stop, it returns after the next row at the latest
+         */
+        void cancel() { cancelled_ = 1; }
+        bool cancelled() const { return int(cancelled_) != 0; }
+
+        /**
+         * number of rows fetched so far
+         */
+        int nRows() const { return int(nRows_); }
+
+        /**
+         * to be called from the GUI thread once the worker has finished.
+         * Writes the tree and returns the path of its file, or an empty
+         * string if the load failed or was cancelled
+         */
+        QString finish();
+
+    signals:
+        /**
+         * emitted from the worker thread every #progressStep rows
+         */
+        void progress(int rows);
+
+    protected:
+        void run();
+
+    private:
+        void rowFetched();
+        bool isState() const;
+
+        TreeBuilder::QRunId runId_;
+        bool                useCache_;
+        bool                result_;
+        QString             sessionName_;
+        QString             analysisId_;
+        QString             analysisType_;
+        QString             key_;
+        QString             cachedFile_;
+        QMap<QString, ColumnBuffer> layouts_;
+        ColumnBuffer        rows_;
+        StateBuffer         stateRows_;
+        QAtomicInt          cancelled_;
+        QAtomicInt          nRows_;
+};
+
+#endif
@@ -4,6 +4,9 @@
 #include <iostream>
 
 TreeViewerRunInfo::~TreeViewerRunInfo() {
+    if (currentTree && referenceTree) currentTree->RemoveFriend(referenceTree);
+    closeInput(currentFile);
+    closeInput(referenceFile);
     if (tmpFile) {
         if (tmpFile->IsOpen()) tmpFile->Close();
         delete tmpFile;
@@ -19,6 +22,7 @@ TreeViewerRunInfo::TreeViewerRunInfo(const QString& tmpFileName_):
     tmpFileName(tmpFileName_),
     currentFile(NULL),
     referenceFile(NULL),
+    tmpFile(NULL),
     currentTree(NULL),
     referenceTree(NULL)
 {
@@ -77,20 +81,38 @@ TEventList* TreeViewerRunInfo::getEventList() {
 void TreeViewerRunInfo::closeTree(bool save) {
     if (currentFile == NULL || tmpFile == NULL) return;
     if (save) {
+        // the input trees are only attached read-only, so a copy is written to the temporary file
         tmpFile->cd();
-        if (referenceTree) referenceTree->Write();
-        if (currentTree) currentTree->Write();
+        if (referenceTree) referenceTree->CloneTree(-1, "fast")->Write("referenceTree");
+        if (currentTree) currentTree->CloneTree(-1, "fast")->Write("currentTree");
         tmpFile->Close();
     }
     else {
         tmpFile->cd();
-        if (referenceTree) {
-            referenceTree->Delete();
-            currentTree->RemoveFriend(referenceTree);
-        }
-        if (currentTree) currentTree->Delete();
+        if (referenceTree && currentTree) currentTree->RemoveFriend(referenceTree);
         tmpFile->Close();
     }
+    closeInput(currentFile);
+    closeInput(referenceFile);
+    currentTree   = NULL;
+    referenceTree = NULL;
+}
+
+void TreeViewerRunInfo::closeInput(TFile*& file) {
+    if (file == NULL) return;
+    if (file->IsOpen()) file->Close();
+    delete file;
+    file = NULL;
+}
+
+void TreeViewerRunInfo::attachReference() {
+    if (currentTree == NULL || referenceTree == NULL) return;
+
+    // align the reference on the device key rather than on the entry number, whenever both trees have it
+    if (currentTree->GetBranch("DeviceId") && currentTree->GetBranch("FeApv") && referenceTree->GetBranch("DeviceId") && referenceTree->GetBranch("FeApv")) {
+        if (referenceTree->GetTreeIndex() == NULL) referenceTree->BuildIndex("DeviceId", "FeApv");
+    }
+    currentTree->AddFriend(referenceTree, "ref");
 }
 
 void TreeViewerRunInfo::buildTreeInfo(QPair<QString, QString> runid_, QPair<QString, QString> treePath_, bool isCurrent) {
@@ -102,21 +124,18 @@ void TreeViewerRunInfo::buildTreeInfo(QPair<QString, QString> runid_, QPair<QStr
         currentFileName = treePath_.first;
         currentTreePath = treePath_.second;
         
-        currentFile = new TFile(qPrintable(currentFileName));
-        TTree* inputCurrentTree   = (TTree*)currentFile->Get(qPrintable(currentTreePath));
+        TFile* inputFile = TFile::Open(qPrintable(currentFileName), "READ");
+        TTree* inputCurrentTree = inputFile ? (TTree*)inputFile->Get(qPrintable(currentTreePath)) : NULL;
         
         if (inputCurrentTree) {
-            tmpFile->cd();
-            if (currentTree) {
-                if (referenceTree) currentTree->RemoveFriend(referenceTree);
-                currentTree->Delete();
-            }
-            currentTree = inputCurrentTree->CloneTree();
+            if (currentTree && referenceTree) currentTree->RemoveFriend(referenceTree);
+            closeInput(currentFile);
+            currentFile = inputFile;
+            currentTree = inputCurrentTree;
             currentTree->SetName("currentTree");
-            inputCurrentTree->Delete();
-            currentFile->Close();
-            if (referenceTree) currentTree->AddFriend(referenceTree, "ref");
+            attachReference();
         }
+        else closeInput(inputFile);
     }
 
     else {
@@ -125,22 +144,22 @@ void TreeViewerRunInfo::buildTreeInfo(QPair<QString, QString> runid_, QPair<QStr
         referenceFileName = treePath_.first;
         referenceTreePath = treePath_.second;
         
-        referenceFile = new TFile(qPrintable(referenceFileName));
-        TTree* inputReferenceTree = (TTree*)referenceFile->Get(qPrintable(referenceTreePath));
+        TFile* inputFile = TFile::Open(qPrintable(referenceFileName), "READ");
+        TTree* inputReferenceTree = inputFile ? (TTree*)inputFile->Get(qPrintable(referenceTreePath)) : NULL;
         
         if (inputReferenceTree) {
-            tmpFile->cd();
-            if (referenceTree) {
-                if (currentTree) currentTree->RemoveFriend(referenceTree);
-                referenceTree->Delete();
-            }
-            referenceTree = inputReferenceTree->CloneTree();
+            if (currentTree && referenceTree) currentTree->RemoveFriend(referenceTree);
+            closeInput(referenceFile);
+            referenceFile = inputFile;
+            referenceTree = inputReferenceTree;
             referenceTree->SetName("referenceTree");
-            inputReferenceTree->Delete();
-            referenceFile->Close();
-            if (currentTree) currentTree->AddFriend(referenceTree, "ref");
+            attachReference();
         }
+        else closeInput(inputFile);
     }
+
+    // histograms and event lists made by the viewer keep living in the temporary file
+    tmpFile->cd();
 }
 
 void TreeViewerRunInfo::useEventList(bool flag) {
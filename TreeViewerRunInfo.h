@@ -31,6 +31,9 @@ class TreeViewerRunInfo {
         TEventList* eventList;
         std::vector<TH1*> summaryHists;
 
+        void closeInput(TFile*&);
+        void attachReference();
+
     public:
         TreeViewerRunInfo(const QString&);
         ~TreeViewerRunInfo();
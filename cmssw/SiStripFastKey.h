@@ -0,0 +1,250 @@
+#ifndef SiStripFastKey_H
+#define SiStripFastKey_H
+
+#include "Constants.h"
+#include "ConstantsForHardwareSystems.h"
+
+/**
+   @file SiStripFastKey.h
+   @brief Lightweight FEC/FED key codecs
+
+   SiStripFastFecKey and SiStripFastFedKey pack and unpack the same
+   32-bit keys as SiStripFecKey and SiStripFedKey, with identical
+   validation of the individual fields, but never build the directory
+   path or the granularity. They are meant for loops that touch every
+   entry of a tree and only need the key or its fields.
+
+   All methods are inline, side-effect free expressions of their
+   arguments, so that they can be turned into constexpr functions as
+   soon as the build moves to C++11.
+*/
+
+namespace sistrip {
+
+  /** Field value if it is null or within [min, max], invalid otherwise. */
+  inline uint16_t fastKeyValue( uint16_t value, uint16_t min, uint16_t max ) {
+    return ( value == 0 || ( value >= min && value <= max ) ) ? value : invalid_;
+  }
+
+  /** Bits of a (validated) field value, the mask signifies "invalid". */
+  inline uint32_t fastKeyBits( uint16_t value, uint16_t mask, uint16_t offset ) {
+    return uint32_t( value == invalid_ ? mask : value ) << offset;
+  }
+
+  /** Raw field of a key, with the mask mapped to "invalid". */
+  inline uint16_t fastKeyField( uint32_t key, uint16_t mask, uint16_t offset ) {
+    return ( ( key >> offset ) & mask ) == mask ? invalid_ : uint16_t( ( key >> offset ) & mask );
+  }
+
+}
+
+/**
+   @class SiStripFastFecKey
+   @brief Field-level codec of the SiStripFecKey 32-bit key
+*/
+class SiStripFastFecKey {
+
+ public:
+
+  /** Constructor using crate, FEC, ring, CCU, module, LLD channel and APV I2C address. */
+  SiStripFastFecKey( uint16_t fec_crate,
+		     uint16_t fec_slot,
+		     uint16_t fec_ring = 0,
+		     uint16_t ccu_addr = 0,
+		     uint16_t ccu_chan = 0,
+		     uint16_t lld_chan = 0,
+		     uint16_t i2c_addr = 0 ) :
+    key_( pack( fec_crate, fec_slot, fec_ring, ccu_addr, ccu_chan, lld_chan, i2c_addr ) ) {;}
+
+  /** Constructor using a 32-bit "FEC key". */
+  explicit SiStripFastFecKey( uint32_t fec_key ) : key_(fec_key) {;}
+
+  inline uint32_t key() const { return key_; }
+
+  inline uint16_t fecCrate() const { return fecCrate( key_ ); }
+  inline uint16_t fecSlot() const { return fecSlot( key_ ); }
+  inline uint16_t fecRing() const { return fecRing( key_ ); }
+  inline uint16_t ccuAddr() const { return ccuAddr( key_ ); }
+  inline uint16_t ccuChan() const { return ccuChan( key_ ); }
+  inline uint16_t lldChan() const { return lldChan( key_ ); }
+  inline uint16_t i2cAddr() const { return i2cAddr( key_ ); }
+
+  // ---------- Static codec ----------
+
+  /** Builds the key exactly as SiStripFecKey does from the same fields. */
+  static inline uint32_t pack( uint16_t fec_crate,
+			       uint16_t fec_slot,
+			       uint16_t fec_ring,
+			       uint16_t ccu_addr,
+			       uint16_t ccu_chan,
+			       uint16_t lld_chan,
+			       uint16_t i2c_addr ) {
+    return
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fec_crate, sistrip::FEC_CRATE_MIN, sistrip::FEC_CRATE_MAX ), fecCrateMask_, fecCrateOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fec_slot, sistrip::CRATE_SLOT_MIN, sistrip::CRATE_SLOT_MAX ), fecSlotMask_, fecSlotOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fec_ring, sistrip::FEC_RING_MIN, sistrip::FEC_RING_MAX ), fecRingMask_, fecRingOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( ccu_addr, sistrip::CCU_ADDR_MIN, sistrip::CCU_ADDR_MAX ), ccuAddrMask_, ccuAddrOffset_ ) |
+      sistrip::fastKeyBits( ccuChanCode( sistrip::fastKeyValue( ccu_chan, sistrip::CCU_CHAN_MIN, sistrip::CCU_CHAN_MAX ) ), ccuChanMask_, ccuChanOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( lld_chan, sistrip::LLD_CHAN_MIN, sistrip::LLD_CHAN_MAX ), lldChanMask_, lldChanOffset_ ) |
+      sistrip::fastKeyBits( i2cAddrCode( sistrip::fastKeyValue( lld_chan, sistrip::LLD_CHAN_MIN, sistrip::LLD_CHAN_MAX ),
+					 sistrip::fastKeyValue( i2c_addr, sistrip::APV_I2C_MIN, sistrip::APV_I2C_MAX ) ), i2cAddrMask_, i2cAddrOffset_ );
+  }
+
+  static inline uint16_t fecCrate( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, fecCrateMask_, fecCrateOffset_ ), sistrip::FEC_CRATE_MIN, sistrip::FEC_CRATE_MAX );
+  }
+
+  static inline uint16_t fecSlot( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, fecSlotMask_, fecSlotOffset_ ), sistrip::CRATE_SLOT_MIN, sistrip::CRATE_SLOT_MAX );
+  }
+
+  static inline uint16_t fecRing( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, fecRingMask_, fecRingOffset_ ), sistrip::FEC_RING_MIN, sistrip::FEC_RING_MAX );
+  }
+
+  static inline uint16_t ccuAddr( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, ccuAddrMask_, ccuAddrOffset_ ), sistrip::CCU_ADDR_MIN, sistrip::CCU_ADDR_MAX );
+  }
+
+  static inline uint16_t ccuChan( uint32_t key ) {
+    return sistrip::fastKeyValue( ccuChanValue( sistrip::fastKeyField( key, ccuChanMask_, ccuChanOffset_ ) ), sistrip::CCU_CHAN_MIN, sistrip::CCU_CHAN_MAX );
+  }
+
+  static inline uint16_t lldChan( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, lldChanMask_, lldChanOffset_ ), sistrip::LLD_CHAN_MIN, sistrip::LLD_CHAN_MAX );
+  }
+
+  static inline uint16_t i2cAddr( uint32_t key ) {
+    return sistrip::fastKeyValue( i2cAddrValue( sistrip::fastKeyField( key, lldChanMask_, lldChanOffset_ ),
+						sistrip::fastKeyField( key, i2cAddrMask_, i2cAddrOffset_ ) ), sistrip::APV_I2C_MIN, sistrip::APV_I2C_MAX );
+  }
+
+ private:
+
+  /** Key stores CCU channels relative to CCU_CHAN_MIN-1. */
+  static inline uint16_t ccuChanCode( uint16_t ccu_chan ) {
+    return ( ccu_chan == 0 || ccu_chan == sistrip::invalid_ ) ? ccu_chan : uint16_t( ccu_chan - ( sistrip::CCU_CHAN_MIN - 1 ) );
+  }
+
+  static inline uint16_t ccuChanValue( uint16_t code ) {
+    return ( code == 0 || code == sistrip::invalid_ ) ? code : uint16_t( code + ( sistrip::CCU_CHAN_MIN - 1 ) );
+  }
+
+  /** LLD channel an APV I2C address belongs to (address is valid or null). */
+  static inline uint16_t lldChanOf( uint16_t i2c_addr ) {
+    return i2c_addr == 0 ? 0 : uint16_t( ( i2c_addr - sistrip::APV_I2C_MIN ) / 2 + 1 );
+  }
+
+  /** Key stores the APV number within the pair (1 or 2) rather than the address. */
+  static inline uint16_t i2cAddrCode( uint16_t lld_chan, uint16_t i2c_addr ) {
+    return
+      i2c_addr == 0 || i2c_addr == sistrip::invalid_ ? i2c_addr :
+      lld_chan != 0 && lldChanOf( i2c_addr ) != lld_chan ? sistrip::invalid_ :
+      ( ( i2c_addr - sistrip::APV_I2C_MIN ) % 2 == 0 ? 1 : 2 );
+  }
+
+  static inline uint16_t i2cAddrValue( uint16_t lld_code, uint16_t i2c_code ) {
+    return
+      i2c_code == 0 || i2c_code == sistrip::invalid_ ? i2c_code :
+      lld_code < sistrip::LLD_CHAN_MIN || lld_code > sistrip::LLD_CHAN_MAX ? sistrip::invalid_ :
+      uint16_t( sistrip::APV_I2C_MIN + lld_code * sistrip::APVS_PER_CHAN - ( i2c_code == 1 ? 2 : 1 ) );
+  }
+
+  // Same layout as SiStripFecKey
+  static const uint16_t fecCrateOffset_ = 27;
+  static const uint16_t fecSlotOffset_  = 22;
+  static const uint16_t fecRingOffset_  = 18;
+  static const uint16_t ccuAddrOffset_  = 10;
+  static const uint16_t ccuChanOffset_  =  5;
+  static const uint16_t lldChanOffset_  =  2;
+  static const uint16_t i2cAddrOffset_  =  0;
+
+  static const uint16_t fecCrateMask_ = 0x07;
+  static const uint16_t fecSlotMask_  = 0x1F;
+  static const uint16_t fecRingMask_  = 0x0F;
+  static const uint16_t ccuAddrMask_  = 0xFF;
+  static const uint16_t ccuChanMask_  = 0x1F;
+  static const uint16_t lldChanMask_  = 0x07;
+  static const uint16_t i2cAddrMask_  = 0x03;
+
+  uint32_t key_;
+
+};
+
+/**
+   @class SiStripFastFedKey
+   @brief Field-level codec of the SiStripFedKey 32-bit key
+*/
+class SiStripFastFedKey {
+
+ public:
+
+  /** Constructor using FED id, FE unit, FE channel, and APV. */
+  SiStripFastFedKey( uint16_t fed_id,
+		     uint16_t fe_unit,
+		     uint16_t fe_chan = 0,
+		     uint16_t fed_apv = 0 ) :
+    key_( pack( fed_id, fe_unit, fe_chan, fed_apv ) ) {;}
+
+  /** Constructor using a 32-bit "FED key". */
+  explicit SiStripFastFedKey( uint32_t fed_key ) : key_(fed_key) {;}
+
+  inline uint32_t key() const { return key_; }
+
+  inline uint16_t fedId() const { return fedId( key_ ); }
+  inline uint16_t feUnit() const { return feUnit( key_ ); }
+  inline uint16_t feChan() const { return feChan( key_ ); }
+  inline uint16_t fedApv() const { return fedApv( key_ ); }
+
+  // ---------- Static codec ----------
+
+  /** Builds the key exactly as SiStripFedKey does from the same fields. */
+  static inline uint32_t pack( uint16_t fed_id,
+			       uint16_t fe_unit = 0,
+			       uint16_t fe_chan = 0,
+			       uint16_t fed_apv = 0 ) {
+    return
+      ( sistrip::fastKeyValue( fed_id, sistrip::FED_ID_MIN, sistrip::FED_ID_MAX ) == sistrip::invalid_ &&
+	sistrip::fastKeyValue( fe_unit, 1, sistrip::FEUNITS_PER_FED ) == sistrip::invalid_ &&
+	sistrip::fastKeyValue( fe_chan, 1, sistrip::FEDCH_PER_FEUNIT ) == sistrip::invalid_ &&
+	sistrip::fastKeyValue( fed_apv, 1, sistrip::APVS_PER_FEDCH ) == sistrip::invalid_ ) ? sistrip::invalid32_ :
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fed_id, sistrip::FED_ID_MIN, sistrip::FED_ID_MAX ), fedIdMask_, fedIdOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fe_unit, 1, sistrip::FEUNITS_PER_FED ), feUnitMask_, feUnitOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fe_chan, 1, sistrip::FEDCH_PER_FEUNIT ), feChanMask_, feChanOffset_ ) |
+      sistrip::fastKeyBits( sistrip::fastKeyValue( fed_apv, 1, sistrip::APVS_PER_FEDCH ), fedApvMask_, fedApvOffset_ );
+  }
+
+  static inline uint16_t fedId( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, fedIdMask_, fedIdOffset_ ), sistrip::FED_ID_MIN, sistrip::FED_ID_MAX );
+  }
+
+  static inline uint16_t feUnit( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, feUnitMask_, feUnitOffset_ ), 1, sistrip::FEUNITS_PER_FED );
+  }
+
+  static inline uint16_t feChan( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, feChanMask_, feChanOffset_ ), 1, sistrip::FEDCH_PER_FEUNIT );
+  }
+
+  static inline uint16_t fedApv( uint32_t key ) {
+    return sistrip::fastKeyValue( sistrip::fastKeyField( key, fedApvMask_, fedApvOffset_ ), 1, sistrip::APVS_PER_FEDCH );
+  }
+
+ private:
+
+  // Same layout as SiStripFedKey
+  static const uint16_t fedIdOffset_  = 10;
+  static const uint16_t feUnitOffset_ =  6;
+  static const uint16_t feChanOffset_ =  2;
+  static const uint16_t fedApvOffset_ =  0;
+
+  static const uint16_t fedIdMask_  = 0x1FF;
+  static const uint16_t feUnitMask_ = 0x00F;
+  static const uint16_t feChanMask_ = 0x00F;
+  static const uint16_t fedApvMask_ = 0x003;
+
+  uint32_t key_;
+
+};
+
+#endif // SiStripFastKey_H
@@ -51,6 +51,11 @@ class Commissioner : public QMainWindow, private Ui::Commissioner {
         }
 
         void showTab(QConnectedTabWidget* w, QString label) {
+            // widgets that are updated in place may ask to be shown again
+            if (tabController->indexOf(w) != -1) {
+                tabController->setCurrentWidget(w);
+                return;
+            }
             tabController->addTab(w, label);
             tabController->setCurrentWidget(w);
             connect(w, SIGNAL(closeParentSignal()), this, SLOT(closeCommissioner()));
@@ -1,10 +1,11 @@
 #include "frmdbupload.h"
-#include "frmterminaldialog.h"
 #include "frmaddskip.h"
 #include "frmterminal.h"
 #include "TreeBuilder.h"
+#include "QueryCache.h"
 #include "cmssw/SiStripFedKey.h"
 #include "cmssw/SiStripFecKey.h"
+#include "cmssw/SiStripFastKey.h"
 #include <fstream>
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
@@ -148,33 +149,33 @@ bool DBUpload::fillSkipList() {
         if (selMap[i] == 0) continue;
    
         if      (selLevel == "FULL") {
-            SiStripFedKey fedkey(int(FedId), int(FeUnit), int(FeChan), 0);
-            SiStripFecKey feckey(int(FecCrate), int(Fec), int(Ring), int(Ccu), int(I2CChannel), int(lasChan)+1, 0);
-            selLevelMap[feckey.key()] = fedkey.key();
+            unsigned feckey = SiStripFastFecKey::pack(int(FecCrate), int(Fec), int(Ring), int(Ccu), int(I2CChannel), int(lasChan)+1, 0);
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), 0);
+            selLevelMap[feckey] = fedkey;
         }
         else if (selLevel == "CCUCHAN") {
-            SiStripFedKey fedkey(int(FedId), int(FeUnit), int(FeChan), 0);
-            SiStripFecKey feckey(int(FecCrate), int(Fec), int(Ring), int(Ccu), int(I2CChannel), 0             , 0);
-            selLevelMap[feckey.key()] = fedkey.key();
+            unsigned feckey = SiStripFastFecKey::pack(int(FecCrate), int(Fec), int(Ring), int(Ccu), int(I2CChannel), 0, 0);
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), 0);
+            selLevelMap[feckey] = fedkey;
         }
         else if (selLevel == "CCU") {
-            SiStripFedKey fedkey(int(FedId), int(FeUnit), int(FeChan), 0);
-            SiStripFecKey feckey(int(FecCrate), int(Fec), int(Ring), int(Ccu), 0              , 0             , 0);
-            selLevelMap[feckey.key()] = fedkey.key();
+            unsigned feckey = SiStripFastFecKey::pack(int(FecCrate), int(Fec), int(Ring), int(Ccu), 0, 0, 0);
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), 0);
+            selLevelMap[feckey] = fedkey;
         }
         else if (selLevel == "RING") {
-            SiStripFedKey fedkey(int(FedId), int(FeUnit), int(FeChan), 0);
-            SiStripFecKey feckey(int(FecCrate), int(Fec), int(Ring), 0       , 0              , 0             , 0);
-            selLevelMap[feckey.key()] = fedkey.key();
+            unsigned feckey = SiStripFastFecKey::pack(int(FecCrate), int(Fec), int(Ring), 0, 0, 0, 0);
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), 0);
+            selLevelMap[feckey] = fedkey;
         }
         else if (selLevel == "FEC") {
-            SiStripFedKey fedkey(int(FedId), int(FeUnit), int(FeChan), 0);
-            SiStripFecKey feckey(int(FecCrate), int(Fec), 0        , 0       , 0              , 0             , 0);
-            selLevelMap[feckey.key()] = fedkey.key();
+            unsigned feckey = SiStripFastFecKey::pack(int(FecCrate), int(Fec), 0, 0, 0, 0, 0);
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), 0);
+            selLevelMap[feckey] = fedkey;
         }
         else if (selLevel == "FED") {
-            SiStripFedKey fedkey(int(FedId), 0, 0, 0);
-            selLevelMap[fedkey.key()] = fedkey.key();
+            unsigned fedkey = SiStripFastFedKey::pack(int(FedId));
+            selLevelMap[fedkey] = fedkey;
         }
     
     }
@@ -207,8 +208,8 @@ bool DBUpload::fillSkipList() {
         itemrow.append(ccuchanitem);
         itemrow.append(llditem    );
 
-        SiStripFecKey feckey(map_iter.key());
-        SiStripFedKey fedkey(map_iter.value());
+        SiStripFastFecKey feckey(map_iter.key());
+        SiStripFastFedKey fedkey(map_iter.value());
 
         fecitem->setData(feckey.key());
 
@@ -520,7 +521,6 @@ void DBUpload::addSkipChannel(QPair<unsigned, unsigned> keys) {
 }
 
 void DBUpload::on_btnUpload_clicked() {
-
     if (currentRun.toInt() == sistrip::MULTIPART) {
 
         if (QMessageBox::question(NULL, QObject::tr("Confirmation"), QObject::tr("You are going to perform Timing O2O. Are you sure you want to continue?"), QMessageBox::Yes, QMessageBox::No) == QMessageBox::No) return;
@@ -604,34 +604,18 @@ void DBUpload::on_btnUpload_clicked() {
         //commandArgs << "/nfshome0/trackerpro/o2o/scripts/testGainO2O.sh" << sveto << nextRun << partFilename << skipFilename;
         //commandArgs << "/nfshome0/trackerpro/o2o/scripts/simpletest.sh" << sveto << nextRun << partFilename << skipFilename;
 
-        bool o2oresult = false;
-        QProcess* proc = new QProcess(this);
-        TkTerminalDialog* timingO2OTerm = new TkTerminalDialog(this);
-        timingO2OTerm->setProcessPtr(proc);
-
-        connect( proc, SIGNAL(readyReadStandardOutput())          , timingO2OTerm, SLOT(readFromStdout())  );
-        connect( proc, SIGNAL(finished(int, QProcess::ExitStatus)), timingO2OTerm, SLOT(processFinished(int, QProcess::ExitStatus)) );
-        QTimer *timer = new QTimer(this);
-        connect(timer, SIGNAL(timeout()), timingO2OTerm, SLOT(executeWaitForReadyRead()));
-        timer->start(100);
-
-        proc->start(commandArgs.join(" "));
-        if (!proc->waitForStarted()) {
-            infoss << "Could not start analysis" << qPrintable(nextRun) << "<br/>";
-            delete timingO2OTerm;
-            o2oresult = false;
-        }
-        else {
-            if (timingO2OTerm->exec()==QDialog::Accepted) o2oresult = true;
-            else o2oresult = false;
-        }
-
-        if (o2oresult) infoss << "<b>O2O process completed successfully</b>" << "<br/>";
-        else           infoss << "<b>O2O process failed</b>"                 << "<br/>";
-
         infoss << "</html>" << std::endl;
+
         QTextCursor cursor(txtCurRunInfo->textCursor());
         cursor.insertHtml(infoss.str().c_str());
+
+        // the O2O runs in a terminal tab, o2oFinished reports the outcome once the script is over
+        TkTerminal* terminal = new TkTerminal();
+        connect(terminal, SIGNAL(processDone(bool)), this, SLOT(o2oFinished(bool)));
+        btnUpload->setEnabled(false);
+        terminal->startProcess(commandArgs.takeFirst(), commandArgs, o2oTimeout);
+        if (terminal->didStartFail()) delete terminal;
+        else emit showTabSignal(terminal, "Timing O2O");
     }
 
     else {
@@ -806,6 +790,7 @@ void DBUpload::on_btnUpload_clicked() {
         QStringList runs = fffdir.entryList(runFilter, QDir::Dirs);
 
         TkTerminal* terminal = new TkTerminal();
+        connect(terminal, SIGNAL(processDone(bool)), this, SLOT(analysisFinished(bool)));
         if (runs.size() > 0) terminal->startProcess("/opt/cmssw/scripts/run_analysis_selup_new.sh", commandArgs);
         else                 terminal->startProcess("/opt/cmssw/scripts/run_analysis_selup.sh", commandArgs);
         if (terminal->didStartFail()) delete terminal;
@@ -814,6 +799,26 @@ void DBUpload::on_btnUpload_clicked() {
     }
 }
 
+void DBUpload::o2oFinished(bool ok) {
+    // the script changes the runs and versions known to the database
+    QueryCache::Inst()->invalidate();
+
+    std::stringstream resultss;
+    resultss << "<html>" << std::endl;
+    if (ok) resultss << "<b>O2O process completed successfully</b>" << "<br/>";
+    else    resultss << "<b>O2O process failed</b>"                 << "<br/>";
+    resultss << "</html>" << std::endl;
+
+    QTextCursor cursor(txtCurRunInfo->textCursor());
+    cursor.insertHtml(resultss.str().c_str());
+    btnUpload->setEnabled(true);
+}
+
+void DBUpload::analysisFinished(bool) {
+    // the script changes the runs and versions known to the database
+    QueryCache::Inst()->invalidate();
+}
+
 bool DBUpload::displayRunInfo() {
 
     if (currentRun == "") {
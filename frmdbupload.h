@@ -20,6 +20,8 @@ class DBUpload : public QConnectedTabWidget, private Ui::DBUpload {
 
         typedef QPair<QString,QString> QRunId; /**< unique ID of a run consisting of partition name and run number */
 
+        static const int o2oTimeout = 2*3600*1000; /**< time in ms after which the O2O script is killed */
+
         void setCurrentRun(const QString&);
         void setCurrentPartition(const QString&);
         void setTree(TTree*);
@@ -58,5 +60,7 @@ class DBUpload : public QConnectedTabWidget, private Ui::DBUpload {
 
         void channelCheckChanged(QStandardItem*);
         void addSkipChannel(QPair<unsigned, unsigned>);
+        void o2oFinished(bool);
+        void analysisFinished(bool);
 };
 #endif
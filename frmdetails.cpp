@@ -16,6 +16,7 @@
 #include <QTextStream>
 #include <QDateTime>
 #include <QMap>
+#include <QHash>
 #include <QPair>
 #include <QFileDialog>
 
@@ -52,7 +53,23 @@ void SelectionDetails::populate(TTree* tree, const QVector<int>& sel, const QStr
             << " WHERE TkAnalysisLog.tagNumber = TkAnalysisTag.tagNumber"
             << " AND TkAnalysisLog.timeStampCloseTicket IS NULL" 
             << " order by ticketid, runnumber";
-    QSqlQuery query(myQuery);
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.exec(myQuery);
+
+    // open tickets per device ID, as pairs of tag number and ticket text, in the order of the query
+    QHash<unsigned, QList<QPair<int, QString> > > openTickets;
+    while(query.next()) {
+        QString strtemplate("Ticket Nr: %1(%3)\n from Run Nr: %2\n Author: %5\n Date: %6 Time: %7\n %4");
+        QString str = strtemplate.arg(query.value(0).toInt())
+                                 .arg(query.value(2).toInt())
+                                 .arg(query.value(3).toString())
+                                 .arg(query.value(4).toString())
+                                 .arg(query.value(5).toString())
+                                 .arg(query.value(6).toDate().toString())
+                                 .arg(query.value(6).toTime().toString());
+        openTickets[query.value(1).toUInt()].push_back(qMakePair(query.value(7).toInt(), str));
+    }
 
     QString myTagQuery;        
     QTextStream tagqueryss(&myTagQuery);
@@ -181,20 +198,12 @@ void SelectionDetails::populate(TTree* tree, const QVector<int>& sel, const QStr
 
         idevId->setCheckable(true);
 
-        query.first();
-        while(query.next()) {
-            if (query.value(1).toDouble() == devId) {
-                QString strtemplate("Ticket Nr: %1(%3)\n from Run Nr: %2\n Author: %5\n Date: %6 Time: %7\n %4");
-                QString str = strtemplate.arg(query.value(0).toInt())
-                                         .arg(query.value(2).toInt())
-                                         .arg(query.value(3).toString())
-                                         .arg(query.value(4).toString())
-                                         .arg(query.value(5).toString())
-                                         .arg(query.value(6).toDate().toString())
-                                         .arg(query.value(6).toTime().toString());
-                QStandardItem* otkt = new QStandardItem(str);
+        QHash<unsigned, QList<QPair<int, QString> > >::const_iterator tickets = openTickets.constFind(unsigned(devId));
+        if (tickets != openTickets.constEnd()) {
+            for (int t = 0; t < tickets->size(); t++) {
+                QStandardItem* otkt = new QStandardItem(tickets->at(t).second);
                 idevId->appendRow(otkt);
-	            openTktMap.insert(std::pair<int,std::pair<int,QStandardItem*> >(query.value(1).toInt(),std::make_pair(query.value(7).toInt(),otkt)));
+                openTktMap.insert(std::pair<int,std::pair<int,QStandardItem*> >(int(devId),std::make_pair(tickets->at(t).first,otkt)));
             }
         }
 
@@ -3,12 +3,13 @@
 #include "Debug.h"
 
 #include <QtSql/QSqlQuery>
-#include <QMap>
+#include <QHash>
 
 #include <TBranch.h>
 
 FedMap::FedMap(QWidget* parent):
     QConnectedTabWidget(parent),
+    labels(NULL),
     performUpload(false)        
 {
     setupUi(this);
@@ -24,7 +25,8 @@ FedMap::FedMap(QWidget* parent):
 }
 
 FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* tree, QWidget *parent): 
-    QConnectedTabWidget(parent)
+    QConnectedTabWidget(parent),
+    labels(NULL)
 {
     setupUi(this);
 
@@ -61,7 +63,9 @@ FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* t
     }
 
     if (tree && tree->GetEntries() == smap.size()) {
-        QMap<unsigned, QVector<QVector<bool> > > markedFeds;
+        // marked FE channels, per FED id
+        QHash<unsigned, QVector<QVector<bool> > > markedFeds;
+        QHash<QString, int> rackIndex;
         
         for (int i = 0; i < 10; i++) {
             fedview::Rack rack;
@@ -69,6 +73,7 @@ FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* t
             if (i != 0) racknamess += QString("VME-S1B0") + QString::number( 10-i);
             else        racknamess += QString("VME-S1B" ) + QString::number( 10  );
             rack.name = racknamess;
+            rackIndex[rack.name] = racks.size();
             racks.push_back(rack);
         }
         for (int i = 10; i < 20; i++) {
@@ -77,6 +82,7 @@ FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* t
             if (i != 10) racknamess += QString("VME-S1C0") + QString::number( 20-i);
             else         racknamess += QString("VME-S1C" ) + QString::number( 10  );
             rack.name = racknamess;
+            rackIndex[rack.name] = racks.size();
             racks.push_back(rack);
         }
 
@@ -99,23 +105,13 @@ FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* t
                 bFedId  ->GetEvent(i);
                 bFedUnit->GetEvent(i);
                 bFedChan->GetEvent(i);
-                bool seenBefore = false;
                 unsigned fid = unsigned(FedId);
                 unsigned fun = unsigned(FedUnit);
                 unsigned fch = unsigned(FedChan);
-                for (QMap<unsigned, QVector<QVector<bool> > >::const_iterator iter = markedFeds.begin(); iter != markedFeds.end(); ++iter) {
-                    if (iter.key() == fid) seenBefore = true;
-                }
-                if (!seenBefore) {
-                    QVector<QVector<bool> > feinfo;
-                    for (int j = 0; j < 8; j++) {
-                        QVector<bool> fechaninfo;
-                        for (int k = 0; k < 12; k++) fechaninfo.push_back(false);
-                        feinfo.push_back(fechaninfo);
-                    }
-                    markedFeds[fid] = feinfo;
-                }
-                markedFeds[fid][fun-1][fch-1] = true;
+                if (fun < 1 || fun > 8 || fch < 1 || fch > 12) continue;
+                QHash<unsigned, QVector<QVector<bool> > >::iterator iter = markedFeds.find(fid);
+                if (iter == markedFeds.end()) iter = markedFeds.insert(fid, QVector<QVector<bool> >(8, QVector<bool>(12, false)));
+                iter.value()[fun-1][fch-1] = true;
             }
         }
         bFedId  ->ResetAddress();
@@ -135,22 +131,17 @@ FedMap::FedMap(const QVector<int>& smap, QPair<QString, QString> runid, TTree* t
             rackname = rackname.remove("-h");
             rackname = rackname.remove("-l");
        
-            QVector<QVector<bool> > feinfo;
-            for (QMap<unsigned, QVector<QVector<bool> > >::const_iterator iter = markedFeds.begin(); iter != markedFeds.end(); ++iter) {
-                if (unsigned(query.value(1).toInt()) == iter.key()) feinfo = iter.value();
-            }
+            QVector<QVector<bool> > feinfo = markedFeds.value(unsigned(query.value(1).toInt()));
         
-            bool rackadded = false;
-            for (int i = 0; i < racks.size(); i++) {
-                if (rackname == racks[i].name) {
-                    rackadded = true;
-                    if      (crateid.contains("-d")) racks[i].d.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
-                    else if (crateid.contains("-h")) racks[i].h.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
-                    else if (crateid.contains("-l")) racks[i].l.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
-                    racks[i].isEmpty = false;
-                }
+            QHash<QString, int>::const_iterator rack = rackIndex.constFind(rackname);
+            if (rack != rackIndex.constEnd()) {
+                int i = rack.value();
+                if      (crateid.contains("-d")) racks[i].d.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
+                else if (crateid.contains("-h")) racks[i].h.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
+                else if (crateid.contains("-l")) racks[i].l.addFed(query.value(2).toInt(), query.value(1).toInt(), feinfo);
+                racks[i].isEmpty = false;
             }
-            if (!rackadded) {
+            else {
                 if (Debug::Inst()->getEnabled()) qDebug() << "Error in rack initialization for crate id " << crateid;
             }
         }
@@ -192,40 +183,21 @@ void FedMap::setupMatrix() {
     setViewInfoVisibility(zoomSlider);
 }
 
-void FedMap::setViewInfoVisibility(QSlider* slider) {
-    for (int i = 0; i < racks.size(); i++) {
-        if (racks[i].isEmpty) continue;
-        for (int j = 0; !racks[i].h.isEmpty && j < racks[i].h.feds.size(); j++) {
-            if (racks[i].h.feds[j].id != 0 && racks[i].h.feds[j].fedtext) {
-                racks[i].h.feds[j].fedtext ->setVisible(slider->value() > 20);
-                racks[i].h.feds[j].slottext->setVisible(slider->value() > 20);
-                for (int k = 0; k < 8; k++) {
-                    racks[i].h.feds[j].units[k].feunittext->setVisible(slider->value() > 20);
-                    for (int l = 0; l < 12; l++) racks[i].h.feds[j].units[k].channels[l].fechannelframe->setVisible(slider->value() > 15);
-                } 
-            }
-        }
-        for (int j = 0; !racks[i].l.isEmpty && j < racks[i].l.feds.size(); j++) {
-            if (racks[i].l.feds[j].id != 0 && racks[i].l.feds[j].fedtext) {
-                racks[i].l.feds[j].fedtext ->setVisible(slider->value() > 20); 
-                racks[i].l.feds[j].slottext->setVisible(slider->value() > 20);
-                for (int k = 0; k < 8; k++) {
-                    racks[i].l.feds[j].units[k].feunittext->setVisible(slider->value() > 20);
-                    for (int l = 0; l < 12; l++) racks[i].l.feds[j].units[k].channels[l].fechannelframe->setVisible(slider->value() > 15);
-                } 
-            }
-        }
-        for (int j = 0; !racks[i].d.isEmpty && j < racks[i].d.feds.size(); j++) {
-            if (racks[i].d.feds[j].id != 0 && racks[i].d.feds[j].fedtext) {
-                racks[i].d.feds[j].fedtext ->setVisible(slider->value() > 20); 
-                racks[i].d.feds[j].slottext->setVisible(slider->value() > 20);
-                for (int k = 0; k < 8; k++) {
-                    racks[i].d.feds[j].units[k].feunittext->setVisible(slider->value() > 20);
-                    for (int l = 0; l < 12; l++) racks[i].d.feds[j].units[k].channels[l].fechannelframe->setVisible(slider->value() > 15);
-                } 
-            }
+void FedMap::setViewInfoVisibility(QSlider*) {
+    // the channel grids are drawn by the FED items themselves depending
+    // on the zoom, the labels all hang off one parent item which is
+    // created the first time they are needed
+    bool showLabels = QStyleOptionGraphicsItem::levelOfDetailFromTransform(graphicsView->transform()) >= fedview::labelLod;
+    if (!labels) {
+        if (!showLabels) return;
+        labels = new QGraphicsRectItem();
+        labels->setPen(Qt::NoPen);
+        for (int i = 0; i < racks.size(); i++) {
+            if (!racks[i].isEmpty) racks[i].createLabels(labels);
         }
+        scene->addItem(labels);
     }
+    labels->setVisible(showLabels);
 }
 
 void FedMap::on_btnZoomIn_clicked() {
@@ -34,6 +34,7 @@ class FedMap : public QConnectedTabWidget, private Ui::FedMap {
     private:
         QVector<fedview::Rack> racks;
         FedGraphicsScene* scene;
+        QGraphicsRectItem* labels;
         QMatrix matrix;
 
         QString run;
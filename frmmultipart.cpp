@@ -13,6 +13,7 @@
 #include "TreeBuilder.h"
 #include "Debug.h"
 #include "DbConnection.h"
+#include "QueryCache.h"
 
 MultiPart::MultiPart(QVector<QString>* tf, QWidget * parent): 
     QConnectedTabWidget(parent)
@@ -29,11 +30,11 @@ MultiPart::~MultiPart() {
 
 void MultiPart::preparePartitionList(const QString& partition, QComboBox * comboBox) {
     QString squery = "select partitionname from viewallrun where local=1 group by partitionname order by max(starttime) desc";
-    QSqlQuery query(squery);
+    QList<QSqlRecord> rows = QueryCache::Inst()->select(squery);
 
     int counter = 0;
-    while (query.next()) { 
-        QString partitionName = query.value(0).toString();
+    for (int i = 0; i < rows.size(); i++) { 
+        QString partitionName = rows[i].value(0).toString();
         if (partitionName.startsWith(partition)) {
             comboBox->insertItem(counter, partitionName);
             counter++;
@@ -63,14 +64,14 @@ void MultiPart::prepareRunList(const QString& partitionName, const QString& runT
     comboBox->clear();
 
     QString squery = QString("select distinct runnumber, modedescription, case when analysisid is not null then 1 else 0 end as analyzed, case when comments = 'BAD' then 1 else 0 end as badflag from viewallrun left outer join analysis using(runnumber) where partitionname='%1' and local = 1 order by RUNNUMBER desc").arg(partitionName);
-    QSqlQuery query(squery);
+    QList<QSqlRecord> rows = QueryCache::Inst()->select(squery);
 
     int counter = 0;
-    while (query.next()) {
-        QString runNumber       = query.value(0).toString();
-        QString modeDescription = query.value(1).toString();
-        bool    analyzed        = query.value(2).toBool();
-        bool    badFlag         = query.value(3).toBool();
+    for (int i = 0; i < rows.size(); i++) {
+        QString runNumber       = rows[i].value(0).toString();
+        QString modeDescription = rows[i].value(1).toString();
+        bool    analyzed        = rows[i].value(2).toBool();
+        bool    badFlag         = rows[i].value(3).toBool();
 
         if (modeDescription != runType) continue;
         if (!analyzed) continue;
@@ -204,6 +205,7 @@ void MultiPart::on_cmbRunTecm_currentIndexChanged(const QString&) {
 }
 
 void MultiPart::on_btnUpdate_clicked() {
+    QueryCache::Inst()->invalidate();
     preparePartitions();
     prepareRuns();
 
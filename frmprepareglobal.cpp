@@ -9,6 +9,7 @@
 #include "frmterminaldialog.h"
 #include "Debug.h"
 #include "DbConnection.h"
+#include "QueryCache.h"
 
 // Defines
 
@@ -530,10 +531,10 @@ QStringList PrepareGlobal::getUsedPartitionNames(QString subDetector, bool& used
     if (DbConnection::Inst()->dbConnected()) {
 	    QString myQuery;
 	    myQuery = QString(SELECTPARTNAMES).arg(subDetector);
-        QSqlQuery query(myQuery);
+        QList<QSqlRecord> rows = QueryCache::Inst()->select(myQuery);
 
-		while (query.next()) {
-		    QString aPartitionName = query.value(0).toString();
+		for (int i = 0; i < rows.size(); i++) {
+		    QString aPartitionName = rows[i].value(0).toString();
 		    partitionNames.append(aPartitionName);
 		}
 	
@@ -811,6 +812,7 @@ bool PrepareGlobal::preparePartitionState(QString partitionName, QString subDete
             QSqlQuery query2(myQuery);
             query2.exec();
             DbConnection::Inst()->dbConnection().commit();
+            QueryCache::Inst()->invalidate();
             result=true;
         }
     } 
@@ -830,6 +832,7 @@ bool PrepareGlobal::confirmO2O(int nextRunNumber) {
 	    QSqlQuery query(myQuery);
         query.exec();
 	    DbConnection::Inst()->dbConnection().commit();
+	    QueryCache::Inst()->invalidate();
 	    result=true;
     } 
     else {
@@ -1,7 +1,7 @@
 #include "frmruninfo.h"
 #include "frmterminaldialog.h"
 #include "TreeBuilder.h"
-#include "cmssw/SiStripFedKey.h"
+#include "cmssw/SiStripFastKey.h"
 #include <sstream>
 #include <fstream>
 #include <QtSql/QSqlQuery>
@@ -266,20 +266,13 @@ bool RunInfo::displayRunInfo() {
             
                 if (selMap[i] == 0) continue;
 
-                SiStripFedKey fedkey(
-                    QString::number(FedId ).toInt(),
-                    QString::number(FeUnit).toInt(),
-                    QString::number(FeChan).toInt(),
-                    QString::number(FeApv ).toInt()
-                );
-
-                selChannels[fedkey.key()] = 1;
+                selChannels[SiStripFastFedKey::pack(int(FedId), int(FeUnit), int(FeChan), int(FeApv))] = 1;
 
             }
 
             QMap<unsigned, int>::const_iterator map_iter = selChannels.constBegin();
             while (map_iter != selChannels.constEnd()) {
-                SiStripFedKey fedkey(map_iter.key());
+                SiStripFastFedKey fedkey(map_iter.key());
 
                 infoss << "\tcms.PSet(" << std::endl << "<br/>";
                 infoss << "\t\t fedId = cms.untracked.uint32("  << fedkey.fedId()  << ")," << std::endl << "<br/>";
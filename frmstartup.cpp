@@ -5,7 +5,8 @@
 #include <QVariant>
 #include <QModelIndex>
 #include <QMessageBox>
-#include <QProcess>
+#include <QFile>
+#include <QFileInfo>
 #include <QDir>
 
 // project includes
@@ -15,11 +16,17 @@
 #include "frmmultipart.h"
 #include "frmprepareglobal.h"
 #include "TreeBuilder.h"
+#include "TreeLoader.h"
 #include "Debug.h"
 #include "DbConnection.h"
+#include "QueryCache.h"
+#include "DbQueryExecutor.h"
 
 Startup::Startup(QWidget * parent): 
-    QConnectedTabWidget(parent)
+    QConnectedTabWidget(parent),
+    loader(0),
+    loadProgress(0),
+    runsTicket(-1)
 {
     setupUi(this); 
 
@@ -39,6 +46,9 @@ Startup::Startup(QWidget * parent):
     connect(partitionView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), this, SLOT(partitionChanged(QModelIndex,QModelIndex)));
     connect(runView->selectionModel(), SIGNAL(currentRowChanged(QModelIndex,QModelIndex)), this, SLOT(runChanged(QModelIndex,QModelIndex)));
     
+    // the runs of a partition are retrieved in the background
+    connect(DbConnection::Inst()->executor(), SIGNAL(finished(const DbQueryResult&)), this, SLOT(runsFetched(const DbQueryResult&)));
+
     // method name says it all
     populatePartitions();
 
@@ -53,20 +63,29 @@ Startup::Startup(QWidget * parent):
 }
 
 Startup::~Startup() {
+    // a pending query is not waited for, the worker deletes itself once it returns
+    cancelLoader();
     deleteTmpFiles();
     delete partitionModel;
     delete runModel;
 }
 
 void Startup::deleteTmpFiles() {
+    // unlinking is cheap, it was starting one rm process per file which made closing slow
+    int    nFiles = 0;
+    qint64 nBytes = 0;
     for (int i = 0; i < tmpfiles.size(); i++) {
-        QProcess rmproc;
-        rmproc.start("rm", QStringList() << tmpfiles[i]);
-        bool wait = true;
-        while(wait) {
-            wait = !rmproc.waitForFinished();
-        } 
+        QFileInfo info(tmpfiles[i]);
+        if (!info.exists()) continue;
+        qint64 size = info.size();
+        if (QFile::remove(tmpfiles[i])) {
+            nFiles++;
+            nBytes += size;
+        }
+        else if (Debug::Inst()->getEnabled()) qDebug() << "Unable to delete " << qPrintable(tmpfiles[i]);
     }
+    if (Debug::Inst()->getEnabled()) qDebug() << "Deleted " << nFiles << " temporary files, " << nBytes << " bytes freed";
+    tmpfiles.clear();
 }
 
 void Startup::addItem(QStandardItemModel* model, const QString &first, const QString &second, bool isRunItem, bool analyzed, bool itemBad) {
@@ -97,12 +116,12 @@ void Startup::addItem(QStandardItemModel* model, const QString &first, const QSt
 
 void Startup::populatePartitions() {
     QString squery = "select partitionname, to_char(  max(starttime),'yyyy-mm-dd' )  as CHANGEDATE from viewallrun where local=1 group by partitionname order by max(starttime) desc";
-    QSqlQuery query(squery);
+    QList<QSqlRecord> rows = QueryCache::Inst()->select(squery);
     partitionModel->clear();
 
-    while (query.next()) { 
-        QString partitionName = query.value(0).toString();
-        QString changeDate    = query.value(1).toString() ;
+    for (int i = 0; i < rows.size(); i++) { 
+        QString partitionName = rows[i].value(0).toString();
+        QString changeDate    = rows[i].value(1).toString() ;
         if (!partitionName.isEmpty()) addItem(partitionModel, partitionName, changeDate);
     }
 
@@ -112,13 +131,35 @@ void Startup::populatePartitions() {
 
 void Startup::populateRuns(const QString &partitionName) {
     QString squery = QString("select distinct runnumber, modedescription, case when analysisid is not null then 1 else 0 end as analyzed, case when comments = 'BAD' then 1 else 0 end as badflag from viewallrun left outer join analysis using(runnumber) where partitionname='%1' and local = 1 order by RUNNUMBER desc").arg(partitionName);
-    QSqlQuery query(squery);
+    QList<QSqlRecord> rows;
+    if (QueryCache::Inst()->find(squery, QVariantList(), rows)) {
+        runsTicket = -1;
+        fillRuns(rows);
+        return;
+    }
+
+    // the list stays empty until the query returns, a later call supersedes this one
+    fillRuns(QList<QSqlRecord>());
+    runsQuery  = squery;
+    runsTicket = DbConnection::Inst()->executor()->submit(squery);
+}
+
+void Startup::runsFetched(const DbQueryResult& result) {
+    if (result.ticket != runsTicket) return;
+    runsTicket = -1;
+    if (!result.ok) return;
+
+    QueryCache::Inst()->insert(runsQuery, QVariantList(), result.rows, result.elapsedMs);
+    fillRuns(result.rows);
+}
+
+void Startup::fillRuns(const QList<QSqlRecord>& rows) {
     runModel->clear();
-    while (query.next()) {
-        QString runNumber       = query.value(0).toString();
-        QString modeDescription = query.value(1).toString() ;
-        bool    analyzed        = query.value(2).toBool() ;
-        bool    badFlag         = query.value(3).toBool() ;
+    for (int i = 0; i < rows.size(); i++) {
+        QString runNumber       = rows[i].value(0).toString();
+        QString modeDescription = rows[i].value(1).toString() ;
+        bool    analyzed        = rows[i].value(2).toBool() ;
+        bool    badFlag         = rows[i].value(3).toBool() ;
         if (!runNumber.isEmpty()) addItem(runModel, runNumber, modeDescription, true, analyzed, badFlag);
     } 
 
@@ -147,6 +188,7 @@ void Startup::runChanged(QModelIndex current, QModelIndex) {
 }
 
 void Startup::on_btnUpdatePartitions_clicked() {
+    QueryCache::Inst()->invalidate();
     populatePartitions();
     partitionView->clearSelection();
     runView->clearSelection();
@@ -154,6 +196,7 @@ void Startup::on_btnUpdatePartitions_clicked() {
 }
 
 void Startup::on_btnUpdateRuns_clicked() {
+    QueryCache::Inst()->invalidate();
     populateRuns(currentPartitionName);
     runView->clearSelection();
 }
@@ -162,20 +205,12 @@ void Startup::on_btnState_clicked() {
     if (cmbState->currentText() == "Select state...") return;
     
     if (Debug::Inst()->getEnabled()) qDebug() << "Creating tree from current state for partition " << qPrintable(currentPartitionName) << "\n";
-    tmpfiles.push_back(QString("/opt/cmssw/shifter/avartak/data/tmp/curstatetmp_")+QDateTime::currentDateTime().toString("dd_MM_yyyy_hh_mm_ss_zzz")+QString(".root")); 
-    TreeViewer *treeview = new TreeViewer(tmpfiles.back());
-
-    bool addRunResult = false;
     if (cmbState->currentText() == "Current State") {
-        TreeBuilder::Inst()->getState(currentPartitionName, sistrip::CURRENTSTATE);
-        addRunResult = treeview->addRun(currentPartitionName, QString::number(sistrip::CURRENTSTATE), true);
+        startLoader(TreeBuilder::QRunId(currentPartitionName, QString::number(sistrip::CURRENTSTATE)), false, tr("Loading the current state of %1").arg(currentPartitionName));
     } 
     else if (cmbState->currentText() == "Last O2O'ed State") {
-        TreeBuilder::Inst()->getState(currentPartitionName,sistrip::LASTO2O);
-        addRunResult = treeview->addRun(currentPartitionName, QString::number(sistrip::LASTO2O), true);
+        startLoader(TreeBuilder::QRunId(currentPartitionName, QString::number(sistrip::LASTO2O)), false, tr("Loading the last O2O'ed state of %1").arg(currentPartitionName));
     }
-    
-    if (addRunResult) emit showTabSignal(treeview, "Tree View");
 }
 
 void Startup::on_btnViewResults_clicked() {
@@ -187,9 +222,76 @@ void Startup::on_btnViewResults_clicked() {
     QStandardItem *run = runModel->itemFromIndex(runList.at(0));
     QString runNumber = run->text();
 
-    tmpfiles.push_back(QString("/opt/cmssw/shifter/avartak/data/tmp/analysistmp_")+QDateTime::currentDateTime().toString("dd_MM_yyyy_hh_mm_ss_zzz")+QString(".root")); 
-    TreeViewer *treeview = new TreeViewer(tmpfiles.back(), chkUseCache->isChecked());
-    if (treeview->addRun(currentPartitionName, runNumber, true)) emit showTabSignal(treeview, "Tree View");
+    startLoader(TreeBuilder::QRunId(currentPartitionName, runNumber), chkUseCache->isChecked(), tr("Loading run %1 of %2").arg(runNumber).arg(currentPartitionName));
+}
+
+void Startup::startLoader(const QPair<QString, QString>& runId, bool useCache, const QString& label) {
+    if (loader) {
+        if (Debug::Inst()->getEnabled()) qDebug() << "Another tree is still being loaded ... \n";
+        return;
+    }
+
+    loader = new TreeLoader(runId, useCache);
+    connect(loader, SIGNAL(progress(int)), this, SLOT(loaderProgress(int)));
+    connect(loader, SIGNAL(finished()), this, SLOT(loaderFinished()));
+
+    loadLabel = label;
+    loadProgress = new QProgressDialog(loadLabel, tr("Cancel"), 0, 0, this);
+    loadProgress->setWindowModality(Qt::WindowModal);
+    loadProgress->setMinimumDuration(0);
+    connect(loadProgress, SIGNAL(canceled()), this, SLOT(cancelLoader()));
+    loadProgress->show();
+
+    loader->start();
+}
+
+void Startup::loaderProgress(int rows) {
+    if (loadProgress) loadProgress->setLabelText(tr("%1\n%2 rows fetched").arg(loadLabel).arg(rows));
+}
+
+void Startup::loaderFinished() {
+    // a cancelled loader is disconnected, but its signal may already be queued
+    if (loader == 0 || sender() != loader) return;
+
+    TreeLoader *done = loader;
+    loader = 0;
+    done->wait();
+    if (loadProgress) {
+        loadProgress->deleteLater();
+        loadProgress = 0;
+    }
+
+    TreeBuilder::QRunId runId = done->runId();
+    bool useCache = done->useCache();
+    QString filename = done->finish();
+    delete done;
+
+    if (filename.isEmpty()) {
+        if (Debug::Inst()->getEnabled()) qDebug() << "Unable to load " << qPrintable(runId.first) << ":" << qPrintable(runId.second) << " ... \n";
+        return;
+    }
+
+    bool isState = (runId.second == QString::number(sistrip::CURRENTSTATE) || runId.second == QString::number(sistrip::LASTO2O));
+    tmpfiles.push_back(QString("/opt/cmssw/shifter/avartak/data/tmp/") + (isState ? "curstatetmp_" : "analysistmp_") + QDateTime::currentDateTime().toString("dd_MM_yyyy_hh_mm_ss_zzz") + QString(".root")); 
+    TreeViewer *treeview = new TreeViewer(tmpfiles.back(), useCache);
+    if (treeview->addRun(runId.first, runId.second, true, filename)) emit showTabSignal(treeview, "Tree View");
+}
+
+void Startup::cancelLoader() {
+    if (loader == 0) return;
+
+    if (Debug::Inst()->getEnabled()) qDebug() << "Cancelling the load after " << loader->nRows() << " rows\n";
+    loader->cancel();
+    disconnect(loader, 0, this, 0);
+    // the worker stops after the next row, or once the pending query returns
+    connect(loader, SIGNAL(finished()), loader, SLOT(deleteLater()));
+    if (loader->isFinished()) loader->deleteLater();
+    loader = 0;
+
+    if (loadProgress) {
+        loadProgress->deleteLater();
+        loadProgress = 0;
+    }
 }
 
 void Startup::on_btnAnalyze_clicked() {
@@ -241,6 +343,7 @@ void Startup::on_btnAnalyze_clicked() {
     
     commandArgs << runNumber << uploadString << uploadAnalString << currentPartitionName << useClientString << disableModulesString << saveClientString;
     TkTerminal* terminal = new TkTerminal();
+    connect(terminal, SIGNAL(processDone(bool)), this, SLOT(analysisFinished(bool)));
 
     QDir fffdir("/raid/fff");
     QStringList runFilter;
@@ -253,6 +356,11 @@ void Startup::on_btnAnalyze_clicked() {
     else emit showTabSignal(terminal, "Run Analysis");
 }
 
+void Startup::analysisFinished(bool) {
+    // the analysis script writes the analysis table
+    QueryCache::Inst()->invalidate();
+}
+
 void Startup::on_btnMarkBad_clicked() {
     QString user = DbConnection::Inst()->dbConnection().userName();
     if (QString::compare( user, tr("cms_trk_tkcc"),  Qt::CaseInsensitive) != 0) QMessageBox::critical(0, tr("Startup"), tr("You are using a wrong database account which does not have write permissions") );
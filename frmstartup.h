@@ -5,6 +5,8 @@
 #include <QVector>
 #include <QMap>
 #include <QMultiMap>
+#include <QList>
+#include <QSqlRecord>
 
 // To set up the run selection tables in the startup window
 #include <QTableWidget>
@@ -18,6 +20,10 @@
 // UI file
 #include "ui_frmstartup.h"
 
+class TreeLoader;
+class QProgressDialog;
+struct DbQueryResult;
+
 /** \Class Startup
  *
  * \brief Class to retrieve a list of partitions and runs and enable
@@ -40,6 +46,11 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
         QStandardItemModel *runModel;
         QString currentPartitionName;
         QVector<QString> tmpfiles;
+        TreeLoader *loader;
+        QProgressDialog *loadProgress;
+        QString loadLabel;
+        QString runsQuery;
+        int runsTicket;
 
         /**
          * generic base method to add an item with a description to a
@@ -50,8 +61,15 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
         /**
          * function which takes a partition name as argument and populates
          * the runView with all commissioning runs from this partition.
+         * Unless they are cached, the runs are retrieved on the
+         * DbQueryExecutor and filled in by runsFetched
          */ 
         void populateRuns(const QString &partitionName);
+
+        /**
+         * fill the runView with rows of the run query
+         */
+        void fillRuns(const QList<QSqlRecord>& rows);
         
         /**
          * function to populate the partitionView. This function will be
@@ -63,6 +81,13 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
          * delete files (trees, etc.) created for the commissioning analysis
          */
         void deleteTmpFiles();
+
+        /**
+         * start loading the tree of a run or of a state on a #TreeLoader
+         * worker, showing the number of rows fetched in a progress dialog
+         * which allows to cancel the load. Only one load runs at a time
+         */
+        void startLoader(const QPair<QString, QString>& runId, bool useCache, const QString& label);
  
     public:
         /**
@@ -85,8 +110,8 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
         
         /**
          * Function to be executed when "View Results" button is pressed.
-         * Currently only passes run and partition to #TreeBuilder and
-         * #TreeViewer to display results. 
+         * Loads the run in the background and passes it to a #TreeViewer
+         * to display results once it is loaded
          */
         void on_btnViewResults_clicked();
         
@@ -114,6 +139,11 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
          * Analyze the selected run
          */ 
         void on_btnAnalyze_clicked();
+
+        /**
+         * drop the cached queries once the analysis script is over
+         */
+        void analysisFinished(bool);
         
         /**
          * Prepare for global running
@@ -139,6 +169,29 @@ class Startup : public QConnectedTabWidget, private Ui::Startup {
          * update run numbers in the runView.
          */
         void partitionChanged(QModelIndex current, QModelIndex previous);
+
+        /**
+         * fill the runView once the run query submitted by populateRuns
+         * is done. Results of other queries are ignored
+         */
+        void runsFetched(const DbQueryResult& result);
+
+        /**
+         * update the number of rows shown in the progress dialog
+         */
+        void loaderProgress(int rows);
+
+        /**
+         * write the tree fetched by the #TreeLoader and show it in a
+         * #TreeViewer
+         */
+        void loaderFinished();
+
+        /**
+         * cancel the running load. The worker is left to stop on its own
+         * and deletes itself, so the GUI does not wait for the database
+         */
+        void cancelLoader();
         
 };
  
@@ -11,6 +11,8 @@
 #include <QStringList>
 #include <QTimer>
 #include <QByteArray>
+#include <QTextCursor>
+#include <QTextDocument>
 
 // UI file
 #include "ui_frmterminal.h"
@@ -24,13 +26,18 @@ class TkTerminal : public QConnectedTabWidget, private Ui::TkTerminal {
 
     Q_OBJECT
  
+    public:
+        static const int maxLines = 10000; /**< number of output lines kept, older ones are dropped */
+
     private:
         QProcess* process;
+        QTimer* timeoutTimer;
         bool startFail;
 
     protected:
         void closeEvent(QCloseEvent* event) {
             if (process != NULL) delete process;
+            process = NULL;
             event->accept();
         }
     
@@ -39,10 +46,18 @@ class TkTerminal : public QConnectedTabWidget, private Ui::TkTerminal {
             QConnectedTabWidget(p)
         {
             setupUi(this);
+            // the document drops its first lines once it holds maxLines
+            textOutput->document()->setMaximumBlockCount(maxLines);
             btnKill->setEnabled(true);
             startFail = false;
             
             process = new QProcess( this );
+            // stderr is shown as well, rather than piling up unread in the process buffer
+            process->setProcessChannelMode(QProcess::MergedChannels);
+
+            timeoutTimer = new QTimer( this );
+            timeoutTimer->setSingleShot(true);
+            connect( timeoutTimer, SIGNAL(timeout()), this, SLOT(processTimedOut()) );
               
             connect( process, SIGNAL(readyReadStandardOutput()), this, SLOT(readFromStdout()) );
             connect( process, SIGNAL(finished(int, QProcess::ExitStatus)), this, SLOT(processFinished(int, QProcess::ExitStatus)) );
@@ -57,14 +72,28 @@ class TkTerminal : public QConnectedTabWidget, private Ui::TkTerminal {
             return startFail;
         }
 
-        void startProcess(QString command, QStringList args) {
+        /**
+         * start the process. If a timeout in ms is given, the process is
+         * killed as with the kill button once it runs for longer
+         */
+        void startProcess(QString command, QStringList args, int timeout = 0) {
             if (Debug::Inst()->getEnabled()) qDebug() << "Starting analysis with command:\n" << command << args;
             process->start(command, args);
+            if (timeout > 0) timeoutTimer->start(timeout);
         }
 
+    signals:
+        /**
+         * emitted once the process is over, ok is true if it exited
+         * normally with exit code 0
+         */
+        void processDone(bool ok);
+
     public Q_SLOTS:
         void on_btnKill_clicked() {
             if (process) {
+                // a pid of 0 would signal the whole process group, this one included
+                if (process->state() == QProcess::NotRunning) return;
                 Q_PID thisPid = process->pid();
                 
                 kill(thisPid, SIGINT);
@@ -82,17 +111,26 @@ class TkTerminal : public QConnectedTabWidget, private Ui::TkTerminal {
                 QByteArray newChunk;
                 newChunk = process->readAllStandardOutput();
                 QString newTextString(newChunk);
-                textOutput->setText(textOutput->toPlainText()+newTextString);
+                textOutput->moveCursor(QTextCursor::End);
+                textOutput->insertPlainText(newTextString);
                 textOutput->ensureCursorVisible();
             }
         }
 
-        void processFinished(int, QProcess::ExitStatus exitStatus) {
+        void processFinished(int exitCode, QProcess::ExitStatus exitStatus) {
             if (Debug::Inst()->getEnabled()) {
-                if (exitStatus==QProcess::NormalExit) qDebug() << "Analysis process exited successfully";
+                if (exitStatus==QProcess::NormalExit) qDebug() << "Analysis process exited with code " << exitCode;
                 else                                  qDebug() << "Analysis process exited with error";
             }
+            timeoutTimer->stop();
             btnKill->setEnabled(false);
+            emit processDone(exitStatus == QProcess::NormalExit && exitCode == 0);
+        }
+
+        void processTimedOut() {
+            textOutput->moveCursor(QTextCursor::End);
+            textOutput->insertPlainText("\n*** Timeout reached, stopping the process ***\n");
+            on_btnKill_clicked();
         }
 
         void processError(QProcess::ProcessError error) {
@@ -102,6 +140,12 @@ class TkTerminal : public QConnectedTabWidget, private Ui::TkTerminal {
             else                                       qDebug() << "Unknown error encountered while executing the process";
             
             startFail = true;
+            // no finished signal follows if the process did not start
+            if (error == QProcess::FailedToStart) {
+                timeoutTimer->stop();
+                btnKill->setEnabled(false);
+                emit processDone(false);
+            }
         }
 
 };
@@ -23,6 +23,9 @@ class TkTerminalDialog : public QDialog, private Ui::TkTerminalDialog {
 
     Q_OBJECT
  
+    public:
+        static const int maxLines = 10000; /**< number of output lines kept, older ones are dropped */
+
     private:
         QProcess* thisProcess_;
         bool correctProcess_;
@@ -57,7 +60,10 @@ class TkTerminalDialog : public QDialog, private Ui::TkTerminalDialog {
                 QByteArray newChunk;
                 newChunk = thisProcess_->readAllStandardOutput();
                 QString newTextString(newChunk);
-                textOutput->setText(textOutput->text()+newTextString);
+                textOutput->moveCursor(Q3TextEdit::MoveEnd, false);
+                textOutput->insert(newTextString);
+                // drop the oldest lines, at most as many as the chunk added
+                while (textOutput->paragraphs() > maxLines) textOutput->removeParagraph(0);
                 textOutput->scrollToBottom();
             }
         }
@@ -44,6 +44,7 @@
 
 #include "QConnectedTabWidget.h"
 #include "Chip.h"
+#include "ChipIndex.h"
 
 #include <vector>
 #include <TTree.h>
@@ -64,6 +65,15 @@ class TkMap : public QConnectedTabWidget
     Q_OBJECT
 public:
     TkMap(QConnectedTabWidget *parent, TTree* tree, const QVector<int>& sm, const QString& vName, float min, float max, const QString& run);
+    /**
+     * map another selection and/or variable of the same tree. Only the
+     * modules whose values change are updated, the scene is kept
+     */
+    void remap(const QVector<int>& sm, const QString& vName, float min, float max);
+    /**
+     * tree the map is filled from
+     */
+    TTree* tree() const { return tree_; }
 
 
     public slots:
@@ -87,6 +97,28 @@ public:
      */
     void setSelection(QList<QGraphicsItem*> &items, bool status);
 private:
+    /**
+     * value of one APV, as read from the tree
+     */
+    struct ApvValue {
+        Double_t value;
+        unsigned feckey;
+        unsigned fedkey;
+        bool operator==(const ApvValue& rhs) const { return value == rhs.value && feckey == rhs.feckey && fedkey == rhs.fedkey; }
+    };
+    /**
+     * values of the selected APVs of one module, and the sum over all
+     * selected entries the module value is the average of
+     */
+    struct ModuleValues {
+        QMap<int, ApvValue> apvs;
+        Double_t sum;
+        int count;
+        ModuleValues() : sum(0.), count(0) {}
+        bool operator==(const ModuleValues& rhs) const { return sum == rhs.sum && count == rhs.count && apvs == rhs.apvs; }
+    };
+    typedef QMap<unsigned long, ModuleValues> ValueMap;
+
     /**
      * set up matrix of the main view
      */
@@ -95,6 +127,14 @@ private:
      * populate GraphicsView with items
      */
     void populateScene();
+    /**
+     * read the values of the selected entries of the tree, per module
+     */
+    void readValues(ValueMap& values);
+    /**
+     * map the values of a module on the TkMap
+     */
+    void applyValues(Chip*, const ModuleValues&);
     /**
      * Map the module on the TkMap
      */
@@ -107,6 +147,9 @@ private:
     QGraphicsScene *scene;
     View *view;
     QMap<unsigned long,Chip*> modules;
+    ValueMap mapped_;
+    ChipIndex index;
+    QList<ChipLayer*> layers;
     TTree* tree_;
     QVector<int> smap;
     QString varName_;
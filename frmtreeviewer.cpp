@@ -31,6 +31,7 @@
 #include <TTreeFormula.h>
 #include <TEventList.h>
 #include <TH1.h>
+#include <TGraph.h>
 #include <TKey.h>
 #include <TEnv.h>
 #include <TStyle.h>
@@ -85,7 +86,7 @@ void TreeViewer::updateCanvas() {
     this->getCanvas()->Update();
 }
 
-bool TreeViewer::addRun(QString partitionName, QString runNumber, bool isCurrent) {
+bool TreeViewer::addRun(QString partitionName, QString runNumber, bool isCurrent, const QString& treeFilename) {
 
     if (runNumber.toInt() == sistrip::CURRENTSTATE || runNumber.toInt() == sistrip::LASTO2O || runNumber.toInt() == sistrip::MULTIPART) {
         btnGetSelected->setEnabled(false);
@@ -100,7 +101,7 @@ bool TreeViewer::addRun(QString partitionName, QString runNumber, bool isCurrent
 
     QRunId runId(partitionName,runNumber);
     if (Debug::Inst()->getEnabled()) qDebug() << "Loading analysis for " << runId.first << ":" << runId.second;
-    QString analysisTreeFilename = TreeBuilder::Inst()->loadAnalysis(runId, useCachedTrees);
+    QString analysisTreeFilename = treeFilename.isEmpty() ? TreeBuilder::Inst()->loadAnalysis(runId, useCachedTrees) : treeFilename;
     if(analysisTreeFilename == "") { 
         if (Debug::Inst()->getEnabled()) qDebug() << "Unable to load analysis " << runId.first << ":" << runId.second << " ... analysis may already be loaded or can't be accessed";
         return false;
@@ -280,14 +281,13 @@ void TreeViewer::draw(bool firstDraw, bool is1D) {
     }
 
     if (firstDraw) {
-        cutString = "";
         invChecked = chkShowInvalid->isChecked();
+        selEngine.load(tree, curDrawX, is1D ? QString("") : curDrawY, getInvalidCutString(invChecked));
     }
-    TEventList evtlist("eventList", "eventList");
 
     QString drawString = getDrawString("h1");
     if (Debug::Inst()->getEnabled()) {
-        qDebug() << "CutString : " << cutString;
+        qDebug() << "Selections: " << selEngine.nSelections();
         qDebug() << "DrawString: " << drawString;
     }
 
@@ -326,21 +326,40 @@ void TreeViewer::draw(bool firstDraw, bool is1D) {
         QString drawSelectedString;
         if (is1D) drawSelectedString = getDrawString("h2", h1->GetNbinsX(), h1->GetBinLowEdge(1), h1->GetBinLowEdge(h1->GetNbinsX())+h1->GetBinWidth(h1->GetNbinsX()));
         else drawSelectedString = getDrawString("");
-        if(Debug::Inst()->getEnabled()) {
-            qDebug() << "Selection CutString : " << cutString;
-            qDebug() << "Selection DrawString: " << drawSelectedString;
+        if(Debug::Inst()->getEnabled()) qDebug() << "Selection DrawString: " << drawSelectedString;
+        selEngine.fillSelMap(selMap);
+        TH1* h2 = NULL;
+        if (selEngine.isScalar()) {
+            selEngine.fillEventList(treeInfo.getEventList());
+            treeInfo.useEventList(true);
+            tree->SetLineColor(kRed);
+            tree->SetMarkerColor(kRed);
+            tree->Draw(qPrintable(drawSelectedString), qPrintable(getInvalidCutString(invChecked)), qPrintable(drawOpt+" P SAME"));
+            treeInfo.useEventList(false);
+            if (is1D) h2 = static_cast<TH1*>(qtCanvas->GetCanvas()->GetPrimitive("h2"));
         }
-        tree->Draw(">>evtlist", qPrintable(cutString + " && " + getInvalidCutString(invChecked)));
-        evtlist.Add((TEventList*)gDirectory->Get("evtlist"));
-        evtlist.Sort();
-        for (int i = 0; i < selMap.size() ; i++) selMap[i] = 0;
-        for (int i = 0; i < evtlist.GetN(); i++) selMap[evtlist.GetEntry(i)] = 1;
-        tree->SetLineColor(kRed);
-        tree->SetMarkerColor(kRed);
-        tree->Draw(qPrintable(drawSelectedString), qPrintable(cutString + " && " + getInvalidCutString(invChecked)), qPrintable(drawOpt+" P SAME"));
-
-        if (is1D) {
-            TH1* h2 = static_cast<TH1*>(qtCanvas->GetCanvas()->GetPrimitive("h2"));
+        else {
+            // the event list selects whole entries, which for arrays would also paint the elements outside the selection
+            std::vector<double> selx, sely;
+            selEngine.selectedInstances(selx, sely);
+            if (is1D) {
+                // owned by the pad once drawn, like the histograms of tree->Draw
+                h2 = new TH1F("h2", "", h1->GetNbinsX(), h1->GetBinLowEdge(1), h1->GetBinLowEdge(h1->GetNbinsX())+h1->GetBinWidth(h1->GetNbinsX()));
+                h2->SetDirectory(0);
+                h2->SetBit(kCanDelete);
+                for (size_t i = 0; i < selx.size(); i++) h2->Fill(selx[i]);
+                h2->SetLineColor(kRed);
+            }
+            else if (!selx.empty()) {
+                TGraph* selected = new TGraph(selx.size(), &selx[0], &sely[0]);
+                selected->SetMarkerStyle(7);
+                selected->SetMarkerColor(kRed);
+                selected->SetBit(kCanDelete);
+                selected->Draw("P");
+            }
+        }
+
+        if (is1D && h2) {
             h1->Draw(qPrintable(drawOpt));
             h2->Draw(qPrintable(drawOpt+" SAME"));
         }
@@ -353,6 +372,13 @@ void TreeViewer::draw(bool firstDraw, bool is1D) {
         yboundmin = getCanvas()->PadtoY(getCanvas()->GetUymin());
         yboundmax = getCanvas()->PadtoY(getCanvas()->GetUymax() - 1e-6);
     }
+    updateTkMap();
+}
+
+void TreeViewer::updateTkMap() {
+    // an open tracker map follows the selection and the drawn variable
+    if (!tkMap || tkMap->tree() != treeInfo.getCurrentTree()) return;
+    tkMap->remap(selMap, curX, xboundmin, xboundmax);
 }
 
 QString TreeViewer::setText(const QString &text, char axis) {
@@ -552,6 +578,7 @@ void TreeViewer::on_btnDraw_clicked() {
     }
     else {
         for (int i = 0; i < selMap.size(); i++) selMap[i] = 0;
+        selEngine.reset();
     }
 
     if ((Y != "(NONE)" && !Y.isEmpty()) || (Z != "(NONE)" && !Z.isEmpty())) qtCanvas->setLockY(false);
@@ -784,25 +811,7 @@ void TreeViewer::catchSelect(QPoint origin, QPoint endpoint) {
 
         if (Debug::Inst()->getEnabled()) qDebug() << curX << "[" << xminedge << ", " << xmaxedge << ")";
 
-        QString varx, cvarx, rvarx;
-        cvarx = curX.toStdString().c_str();
-        rvarx = QString("ref.") + curX.toStdString().c_str();
-
-        if      ( curRefX &&  curDiffX) varx = "(" + rvarx + " - " + cvarx + ")";
-        else if ( curRefX && !curDiffX) varx = rvarx;
-        else if (!curRefX &&  curDiffX) varx = "(" + cvarx + " - " + rvarx + ")";
-        else                            varx = cvarx;
-
-        cutString.prepend("(");
-        if (cmbCutOpt->currentText() == "select") {
-            if (cutString != "(") cutString += " || ";
-            cutString += "(" + varx + " >= " + QString::number(xminedge) + " && " + varx + " < "  + QString::number(xmaxedge) + ")";
-        }
-        else {
-            if (cutString != "(") cutString += " && ";
-            cutString += "(" + varx + " < "  + QString::number(xminedge) + " || " + varx + " >= " + QString::number(xmaxedge) + ")";
-        }
-        cutString += ")";
+        selEngine.select(xminedge, xmaxedge, 0., 0., cmbCutOpt->currentText() != "select");
 
         draw(false, true);
     }
@@ -835,41 +844,7 @@ void TreeViewer::catchSelect(QPoint origin, QPoint endpoint) {
         if (Debug::Inst()->getEnabled()) qDebug() << curX << "[" << xmin << ", " << xmax << ")";
         if (Debug::Inst()->getEnabled()) qDebug() << curY << "[" << ymin << ", " << ymax << ")";
 
-        QString varx, cvarx, rvarx;
-        QString vary, cvary, rvary;
-        cvarx = curX.toStdString().c_str();
-        cvary = curY.toStdString().c_str();
-        rvarx = QString("ref.") + curX.toStdString().c_str();
-        rvary = QString("ref.") + curY.toStdString().c_str();
-
-        if      ( curRefX &&  curDiffX) varx = "(" + rvarx + " - " + cvarx + ")";
-        else if ( curRefX && !curDiffX) varx = rvarx;
-        else if (!curRefX &&  curDiffX) varx = "(" + cvarx + " - " + rvarx + ")";
-        else                            varx = cvarx;
-
-        if      ( curRefY &&  curDiffY) vary = "(" + rvary + " - " + cvary + ")";
-        else if ( curRefY && !curDiffY) vary = rvary;
-        else if (!curRefY &&  curDiffY) vary = "(" + cvary + " - " + rvary + ")";
-        else                            vary = cvary;
-
-        cutString.prepend("(");
-        if (cmbCutOpt->currentText() == "select") {
-            if (cutString != "(") cutString += " || ";
-            cutString += "(";
-            cutString += varx + " >= " + QString::number(xmin) + " && " + varx + " < "  + QString::number(xmax);
-            cutString += " && ";
-            cutString += vary + " >= " + QString::number(ymin) + " && " + vary + " < "  + QString::number(ymax);
-            cutString += ")";
-        }
-        else {
-            if (cutString != "(") cutString += " && ";
-            cutString += "(";
-            cutString += varx + " < "  + QString::number(xmin) + " || " + varx + " >= " + QString::number(xmax);
-            cutString += " || ";
-            cutString += vary + " < "  + QString::number(ymin) + " || " + vary + " >= " + QString::number(ymax);
-            cutString += ")";
-        }
-        cutString += ")";
+        selEngine.select(xmin, xmax, ymin, ymax, cmbCutOpt->currentText() != "select");
         draw(false, false);
     }
 }
@@ -892,8 +867,13 @@ void TreeViewer::on_btnTkMap_clicked() {
         return;
     }
 
-    TkMap* tkmap = new TkMap(0, treeInfo.getCurrentTree(), selMap, curX, xboundmin, xboundmax, treeInfo.getCurrentRunNumber());
-    emit showTabSignal(tkmap, "Tracker Map");
+    if (tkMap && tkMap->tree() == treeInfo.getCurrentTree()) {
+        tkMap->remap(selMap, curX, xboundmin, xboundmax);
+    }
+    else {
+        tkMap = new TkMap(0, treeInfo.getCurrentTree(), selMap, curX, xboundmin, xboundmax, treeInfo.getCurrentRunNumber());
+    }
+    emit showTabSignal(tkMap, "Tracker Map");
 }
 
 void TreeViewer::on_btnFedMap_clicked() {
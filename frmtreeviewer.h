@@ -9,12 +9,16 @@
 
 // Qt includes
 #include <QVector>
+#include <QPointer>
 
 // UI file
 #include "ui_frmtreeviewer.h"
 
 // Qt project includes 
 #include "TreeViewerRunInfo.h"
+#include "SelectionEngine.h"
+
+class TkMap;
 
 class TreeViewer : public QConnectedTabWidget, private Ui::TreeViewer {
 
@@ -25,7 +29,11 @@ class TreeViewer : public QConnectedTabWidget, private Ui::TreeViewer {
         
         TreeViewer(const QString& tmpfilename, bool useCache = false, QWidget *parent = 0);
         ~TreeViewer();
-        bool addRun(QString, QString, bool);
+        /**
+         * add a run as current or reference run. The tree is loaded
+         * through the TreeBuilder unless the file holding it is given
+         */
+        bool addRun(QString, QString, bool, const QString& treeFilename = "");
 
     public Q_SLOTS:
         void catchRef(QString, QString, bool);
@@ -72,6 +80,7 @@ class TreeViewer : public QConnectedTabWidget, private Ui::TreeViewer {
         void varChanged(const QString& text, QString& var, int& bins, QSpinBox *box, QLabel *label, char);
         void setDrawOptions(int d);
         void draw(bool, bool);
+        void updateTkMap();
         QString getDimString(char);
         QString getDrawString(QString, unsigned int bins = 0, double min = 0., double max = 0.);
         QString getInvalidCutString(bool);
@@ -85,11 +94,13 @@ class TreeViewer : public QConnectedTabWidget, private Ui::TreeViewer {
         QVector<TH1*> summaryHists;
         TreeViewerRunInfo treeInfo;
         QVector<int> selMap;
+        SelectionEngine selEngine;
+        QPointer<TkMap> tkMap;
         QVector<QPair<QString, QString> > varList, refVarList;
         QString X, Y, Z, curX, curY, curZ, curDrawX, curDrawY, curDrawZ;
         bool curRefX, curRefY, curRefZ, curDiffX, curDiffY, curDiffZ;
         bool sameRefRunType;
-        QString drawOpt, cutString;
+        QString drawOpt;
         double xboundmin, xboundmax, yboundmin, yboundmax;
 };
 #endif
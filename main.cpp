@@ -8,6 +8,8 @@
 #include "Debug.h"
 // Class that handles DB connection
 #include "DbConnection.h"
+// Class that manages the cached analysis trees
+#include "TreeCache.h"
 // TkCommissioiner UI
 #include "frmcommissioner.h"
 
@@ -50,6 +52,11 @@ int main(int argc, char ** argv) {
     confDb = getenv ("CONFDB");
     DbConnection::Inst()->connectDb(std::string(confDb));
 
+    // Directory of the cached analysis trees, if not the default one
+    char* cacheDir;
+    cacheDir = getenv ("TKCACHEDIR");
+    if (cacheDir) TreeCache::Inst()->setCacheDir(QString(cacheDir));
+
     // Splash screen at start up
     QPixmap pixmap("/opt/cmssw/shifter/avartak/qtRoot/NewCommissioningGui/Stable/TkCommissioner/images/slide_TIB_lights2.png"); 
     QSplashScreen *splash = new QSplashScreen( pixmap );
@@ -71,5 +78,11 @@ int main(int argc, char ** argv) {
     splash->finish(tkcom);
     app.connect(tkcom, SIGNAL(destroyed()), &app, SLOT(quit()) );
     
-    return app.exec();
+    int result = app.exec();
+
+    // the worker sessions have to be closed while the application still exists
+    DbConnection::Inst()->stopExecutor();
+    // keep the access order of the cached trees for the next session
+    TreeCache::Inst()->flush();
+    return result;
 }
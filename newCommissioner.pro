@@ -6,16 +6,24 @@ UI_DIR      = .ui
 
 HEADERS +=  Debug.h \
             DbConnection.h \
+            DbQueryExecutor.h \
+            QueryCache.h \
             QConnectedTabWidget.h \
             CustomTQtWidget.h \
             BaseTypes.h \
             TreeBuilder.h \
+            StripDecoder.h \
+            TreeCache.h \
+            TreeLoader.h \
             TreeViewerRunInfo.h \ 
+            SelectionEngine.h \
             FedView.h \
             FedGraphicsView.h \            
             FedGraphicsScene.h \ 
             TkMapGlobals.h \
+            TkMapGeometry.h \
             Chip.h \
+            ChipIndex.h \
             TkView.h \
             frmcommissioner.h \
             frmstartup.h \
@@ -36,18 +44,27 @@ HEADERS +=  Debug.h \
             frmpartitions.h \
             frmterminaldialog.h \
             cmssw/SiStripFecKey.h \
-            cmssw/SiStripFedKey.h
+            cmssw/SiStripFedKey.h \
+            cmssw/SiStripFastKey.h
 
 SOURCES +=  main.cpp \
             Debug.cpp \
             DbConnection.cpp \
+            DbQueryExecutor.cpp \
+            QueryCache.cpp \
             TreeBuilder.cpp \
+            StripDecoder.cpp \
+            TreeCache.cpp \
+            TreeLoader.cpp \
             TreeViewerRunInfo.cpp \ 
+            SelectionEngine.cpp \
             FedView.cpp \
             FedGraphicsView.cpp \            
             FedGraphicsScene.cpp \            
             Chip.cpp \
+            ChipIndex.cpp \
             TkView.cpp \
+            TkMapGeometry.cpp \
             frmstartup.cpp \
             frmtreeviewer.cpp \
             frmdbupload.cpp \
@@ -80,3 +97,19 @@ FORMS +=    uifiles/frmcommissioner.ui \
             uifiles/frmpartitions.ui \
             uifiles/frmterminaldialog.ui \
             uifiles/frmmultipart.ui
+
+# binary tracker map layout, converted from tkmap_bare by tools/tkmapconv
+tkmapbin.target   = $$PWD/tkmap_bare.bin
+tkmapbin.depends  = $$PWD/tkmap_bare $$PWD/TkMapGeometry.cpp
+tkmapbin.commands = cd $$PWD/tools/tkmapconv && $(QMAKE) tkmapconv.pro && $(MAKE) && ./tkmapconv $$PWD/tkmap_bare $$PWD/tkmap_bare.bin
+QMAKE_EXTRA_TARGETS += tkmapbin
+PRE_TARGETDEPS      += $$PWD/tkmap_bare.bin
+
+# "make check" compares the ASCII and binary tracker map layouts, the
+# strip CLOB decoder with the hex string decoding it replaced and the
+# fast FEC/FED keys with SiStripFecKey and SiStripFedKey
+tkmapcheck.commands = cd $$PWD/tools/tkmapcheck && $(QMAKE) tkmapcheck.pro && $(MAKE) && ./tkmapcheck $$PWD/tkmap_bare
+stripcheck.commands = cd $$PWD/tools/stripcheck && $(QMAKE) stripcheck.pro && $(MAKE) && ./stripcheck
+keycheck.commands   = cd $$PWD/tools/keycheck && $(QMAKE) keycheck.pro && $(MAKE) && ./keycheck
+check.depends       = tkmapcheck stripcheck keycheck
+QMAKE_EXTRA_TARGETS += tkmapcheck stripcheck keycheck check
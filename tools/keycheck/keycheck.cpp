@@ -0,0 +1,167 @@
+#include "cmssw/SiStripFecKey.h"
+#include "cmssw/SiStripFedKey.h"
+#include "cmssw/SiStripFastKey.h"
+
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+/*
+ * Checks SiStripFastFecKey and SiStripFastFedKey against SiStripFecKey
+ * and SiStripFedKey: combinations of null and valid fields, plus the
+ * values just outside the valid ranges, have to give the same key, and
+ * the fields decoded from that key have to be the same. Then times both
+ * codecs on the same keys
+ *
+ * usage : keycheck
+ */
+
+namespace {
+
+    // null, the valid range, and the values next to it
+    std::vector<uint16_t> fieldValues(uint16_t min, uint16_t max) {
+        std::vector<uint16_t> values;
+        values.push_back(0);
+        if (min > 1) values.push_back(min - 1);
+        for (uint16_t v = min; v <= max; v++) values.push_back(v);
+        values.push_back(max + 1);
+        return values;
+    }
+
+    double seconds(clock_t start) {
+        return double(clock() - start) / CLOCKS_PER_SEC;
+    }
+
+    long checkFecKeys(std::vector<uint32_t>& keys) {
+        std::vector<uint16_t> crates = fieldValues(sistrip::FEC_CRATE_MIN, sistrip::FEC_CRATE_MAX);
+        std::vector<uint16_t> slots  = fieldValues(sistrip::CRATE_SLOT_MIN, sistrip::CRATE_SLOT_MAX);
+        std::vector<uint16_t> rings  = fieldValues(sistrip::FEC_RING_MIN, sistrip::FEC_RING_MAX);
+        std::vector<uint16_t> ccus   = fieldValues(sistrip::CCU_ADDR_MIN, sistrip::CCU_ADDR_MAX);
+        std::vector<uint16_t> chans  = fieldValues(sistrip::CCU_CHAN_MIN, sistrip::CCU_CHAN_MAX);
+        std::vector<uint16_t> llds   = fieldValues(sistrip::LLD_CHAN_MIN, sistrip::LLD_CHAN_MAX);
+        std::vector<uint16_t> i2cs   = fieldValues(sistrip::APV_I2C_MIN, sistrip::APV_I2C_MAX);
+
+        // the CCU address field is independent of the others, every value
+        // of it is checked on one branch and only its boundaries are
+        // combined with all values of the other fields
+        std::vector<uint16_t> ccuBoundaries;
+        ccuBoundaries.push_back(0);
+        ccuBoundaries.push_back(sistrip::CCU_ADDR_MIN);
+        ccuBoundaries.push_back(sistrip::CCU_ADDR_MAX);
+        ccuBoundaries.push_back(sistrip::CCU_ADDR_MAX + 1);
+
+        long errors = 0;
+        for (size_t a = 0; a < crates.size(); a++)
+        for (size_t b = 0; b < slots.size(); b++)
+        for (size_t c = 0; c < rings.size(); c++)
+        for (size_t d = 0; d < ccus.size(); d++)
+        for (size_t e = 0; e < chans.size(); e++)
+        for (size_t f = 0; f < llds.size(); f++)
+        for (size_t g = 0; g < i2cs.size(); g++) {
+            bool boundary = std::find(ccuBoundaries.begin(), ccuBoundaries.end(), ccus[d]) != ccuBoundaries.end();
+            bool branch   = crates[a] == sistrip::FEC_CRATE_MIN && slots[b] == sistrip::CRATE_SLOT_MIN && rings[c] == sistrip::FEC_RING_MIN;
+            if (!boundary && !branch) continue;
+
+            SiStripFecKey     slow(crates[a], slots[b], rings[c], ccus[d], chans[e], llds[f], i2cs[g]);
+            SiStripFastFecKey fast(crates[a], slots[b], rings[c], ccus[d], chans[e], llds[f], i2cs[g]);
+            SiStripFecKey     slowDecoded(slow.key());
+            SiStripFastFecKey fastDecoded(slow.key());
+            keys.push_back(slow.key());
+
+            if (fast.key() != slow.key() ||
+                fastDecoded.fecCrate() != slowDecoded.fecCrate() ||
+                fastDecoded.fecSlot()  != slowDecoded.fecSlot()  ||
+                fastDecoded.fecRing()  != slowDecoded.fecRing()  ||
+                fastDecoded.ccuAddr()  != slowDecoded.ccuAddr()  ||
+                fastDecoded.ccuChan()  != slowDecoded.ccuChan()  ||
+                fastDecoded.lldChan()  != slowDecoded.lldChan()  ||
+                fastDecoded.i2cAddr()  != slowDecoded.i2cAddr()) {
+                if (errors < 10) std::cerr << "FEC key mismatch for " << crates[a] << "/" << slots[b] << "/" << rings[c] << "/" << ccus[d] << "/" << chans[e] << "/" << llds[f] << "/" << i2cs[g]
+                                           << " : " << std::hex << slow.key() << " vs " << fast.key() << std::dec << std::endl;
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    long checkFedKeys(std::vector<uint32_t>& keys) {
+        std::vector<uint16_t> ids   = fieldValues(sistrip::FED_ID_MIN, sistrip::FED_ID_MAX);
+        std::vector<uint16_t> units = fieldValues(1, sistrip::FEUNITS_PER_FED);
+        std::vector<uint16_t> chans = fieldValues(1, sistrip::FEDCH_PER_FEUNIT);
+        std::vector<uint16_t> apvs  = fieldValues(1, sistrip::APVS_PER_FEDCH);
+
+        long errors = 0;
+        for (size_t a = 0; a < ids.size(); a++)
+        for (size_t b = 0; b < units.size(); b++)
+        for (size_t c = 0; c < chans.size(); c++)
+        for (size_t d = 0; d < apvs.size(); d++) {
+            SiStripFedKey     slow(ids[a], units[b], chans[c], apvs[d]);
+            SiStripFastFedKey fast(ids[a], units[b], chans[c], apvs[d]);
+            SiStripFedKey     slowDecoded(slow.key());
+            SiStripFastFedKey fastDecoded(slow.key());
+            keys.push_back(slow.key());
+
+            if (fast.key() != slow.key() ||
+                fastDecoded.fedId()  != slowDecoded.fedId()  ||
+                fastDecoded.feUnit() != slowDecoded.feUnit() ||
+                fastDecoded.feChan() != slowDecoded.feChan() ||
+                fastDecoded.fedApv() != slowDecoded.fedApv()) {
+                if (errors < 10) std::cerr << "FED key mismatch for " << ids[a] << "/" << units[b] << "/" << chans[c] << "/" << apvs[d]
+                                           << " : " << std::hex << slow.key() << " vs " << fast.key() << std::dec << std::endl;
+                errors++;
+            }
+        }
+        return errors;
+    }
+
+    void benchmark(const std::vector<uint32_t>& fecKeys, const std::vector<uint32_t>& fedKeys) {
+        unsigned long sum = 0;
+
+        clock_t start = clock();
+        for (size_t i = 0; i < fecKeys.size(); i++) {
+            SiStripFecKey key(fecKeys[i]);
+            sum += key.fecCrate() + key.fecSlot() + key.fecRing() + key.ccuAddr() + key.ccuChan() + key.lldChan() + key.i2cAddr();
+        }
+        double slowFec = seconds(start);
+
+        start = clock();
+        for (size_t i = 0; i < fecKeys.size(); i++) {
+            SiStripFastFecKey key(fecKeys[i]);
+            sum += key.fecCrate() + key.fecSlot() + key.fecRing() + key.ccuAddr() + key.ccuChan() + key.lldChan() + key.i2cAddr();
+        }
+        double fastFec = seconds(start);
+
+        start = clock();
+        for (size_t i = 0; i < fedKeys.size(); i++) {
+            SiStripFedKey key(fedKeys[i]);
+            sum += key.fedId() + key.feUnit() + key.feChan() + key.fedApv();
+        }
+        double slowFed = seconds(start);
+
+        start = clock();
+        for (size_t i = 0; i < fedKeys.size(); i++) {
+            SiStripFastFedKey key(fedKeys[i]);
+            sum += key.fedId() + key.feUnit() + key.feChan() + key.fedApv();
+        }
+        double fastFed = seconds(start);
+
+        std::cout << "Decoding " << fecKeys.size() << " FEC keys : " << slowFec << " s with SiStripFecKey, " << fastFec << " s with SiStripFastFecKey" << std::endl;
+        std::cout << "Decoding " << fedKeys.size() << " FED keys : " << slowFed << " s with SiStripFedKey, " << fastFed << " s with SiStripFastFedKey" << std::endl;
+        std::cout << "(checksum " << sum << ")" << std::endl;
+    }
+
+}
+
+int main() {
+    std::vector<uint32_t> fecKeys, fedKeys;
+    long errors = checkFecKeys(fecKeys) + checkFedKeys(fedKeys);
+    if (errors) {
+        std::cerr << errors << " mismatches" << std::endl;
+        return 1;
+    }
+    std::cout << "All " << fecKeys.size() << " FEC keys and " << fedKeys.size() << " FED keys match" << std::endl;
+
+    benchmark(fecKeys, fedKeys);
+    return 0;
+}
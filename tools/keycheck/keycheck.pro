@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET = keycheck
+CONFIG += console
+CONFIG -= app_bundle qt
+
+INCLUDEPATH += ../..
+
+OBJECTS_DIR = .obj
+
+HEADERS += ../../cmssw/SiStripKey.h \
+           ../../cmssw/SiStripFecKey.h \
+           ../../cmssw/SiStripFedKey.h \
+           ../../cmssw/SiStripFastKey.h
+
+SOURCES += ../../cmssw/SiStripKey.cc \
+           ../../cmssw/SiStripFecKey.cc \
+           ../../cmssw/SiStripFedKey.cc \
+           keycheck.cpp
@@ -0,0 +1,125 @@
+#include "StripDecoder.h"
+
+#include <QByteArray>
+#include <QTime>
+#include <QVector>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+/*
+ * Checks StripDecoder::decode bit for bit against the decoding
+ * TreeBuilder::getState did before: base64 to hex, 8 character slices,
+ * byte reversal and toLong per strip. Random CLOBs of all lengths up to
+ * a few strips more than an APV holds are decoded, with and without the
+ * line breaks of wrapped base64 text. Then times both decoders on a
+ * partition worth of APVs
+ *
+ * usage : stripcheck
+ */
+
+namespace {
+
+    const double untouched = -1.;
+
+    // the decoding of TreeBuilder::getState before StripDecoder
+    void decodeReference(const QByteArray& clob, double* Noise, double* Pedestal) {
+        QByteArray array = QByteArray::fromBase64(clob).toHex();
+        int index = 0;
+        for( int i = 0; i < array.size(); i+=8, ++index ) {
+            QByteArray mystrip = array.mid(i,8);
+            QByteArray mystrip2;
+            for( int k = mystrip.size(); k >= 0; k-=2 ) mystrip2 += mystrip.mid(k,2);
+            bool ok;
+            long strip = mystrip2.toLong(&ok,16);
+            float noise   = static_cast<float>    ( ( strip >> 13 ) & 0x000001FF ) / 10.0;
+            uint16_t ped  = static_cast<uint16_t> ( ( strip >> 22 ) & 0x000003FF );
+
+            if ( index < 128 ) {
+                Noise[index] = noise;
+                Pedestal[index] = ped;
+            }
+        }
+    }
+
+    QByteArray randomClob(int nbytes, bool wrapped) {
+        QByteArray raw(nbytes, 0);
+        for (int i = 0; i < nbytes; i++) raw[i] = char(rand() & 0xFF);
+        QByteArray clob = raw.toBase64();
+        if (!wrapped) return clob;
+
+        QByteArray lines;
+        for (int i = 0; i < clob.size(); i += 76) lines += clob.mid(i, 76) + "\n";
+        return lines;
+    }
+
+    void reset(double* values) {
+        for (int i = 0; i < StripDecoder::nStrips; i++) values[i] = untouched;
+    }
+
+    int check() {
+        int errors = 0;
+        double noise[StripDecoder::nStrips], pedestal[StripDecoder::nStrips];
+        double refNoise[StripDecoder::nStrips], refPedestal[StripDecoder::nStrips];
+
+        for (int nbytes = 0; nbytes <= 4 * (StripDecoder::nStrips + 4); nbytes++) {
+            for (int trial = 0; trial < 20; trial++) {
+                QByteArray clob = randomClob(nbytes, trial % 2 == 1);
+                reset(noise);
+                reset(pedestal);
+                reset(refNoise);
+                reset(refPedestal);
+
+                StripDecoder::decode(clob.constData(), clob.size(), noise, pedestal);
+                decodeReference(clob, refNoise, refPedestal);
+
+                if (memcmp(noise, refNoise, sizeof(noise)) != 0 || memcmp(pedestal, refPedestal, sizeof(pedestal)) != 0) {
+                    if (errors < 10) std::cerr << "Mismatch for a CLOB of " << nbytes << " bytes : " << clob.constData() << std::endl;
+                    errors++;
+                }
+            }
+        }
+        return errors;
+    }
+
+    void benchmark() {
+        // roughly the number of APVs of CURRENTSTATE and LASTO2O
+        const int nApvs = 75000;
+        QVector<QByteArray> clobs;
+        for (int i = 0; i < nApvs; i++) clobs.push_back(randomClob(4 * StripDecoder::nStrips, false));
+
+        double noise[StripDecoder::nStrips], pedestal[StripDecoder::nStrips], sum = 0;
+        QTime timer;
+
+        timer.start();
+        for (int i = 0; i < nApvs; i++) {
+            decodeReference(clobs[i], noise, pedestal);
+            sum += noise[0] + pedestal[StripDecoder::nStrips - 1];
+        }
+        int reference = timer.elapsed();
+
+        timer.start();
+        for (int i = 0; i < nApvs; i++) {
+            StripDecoder::decode(clobs[i].constData(), clobs[i].size(), noise, pedestal);
+            sum += noise[0] + pedestal[StripDecoder::nStrips - 1];
+        }
+        int decoder = timer.elapsed();
+
+        std::cout << "Decoding " << nApvs << " APVs : " << reference << " ms through hex strings, " << decoder << " ms with StripDecoder" << std::endl;
+        std::cout << "(checksum " << sum << ")" << std::endl;
+    }
+
+}
+
+int main() {
+    int errors = check();
+    if (errors) {
+        std::cerr << errors << " mismatches" << std::endl;
+        return 1;
+    }
+    std::cout << "All CLOBs decode the same" << std::endl;
+
+    benchmark();
+    return 0;
+}
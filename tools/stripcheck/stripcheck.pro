@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = stripcheck
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+INCLUDEPATH += ../..
+
+OBJECTS_DIR = .obj
+
+HEADERS += ../../StripDecoder.h
+
+SOURCES += ../../StripDecoder.cpp \
+           stripcheck.cpp
@@ -0,0 +1,115 @@
+#include "TkMapGeometry.h"
+
+#include <QMap>
+#include <QVector>
+#include <QPointF>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*
+ * Checks the tracker map layout tables against the ASCII layout. The
+ * ASCII file is read here on its own, the way TkMap read it before the
+ * binary table existed: detid first, then y in the odd and x in the even
+ * fields. Every outline has to come out the same from
+ * TkMapGeometry::loadAscii and from a binary table written by
+ * TkMapGeometry::saveBinary and mapped by TkMapGeometry::loadBinary
+ *
+ * usage : tkmapcheck <ascii layout>
+ */
+
+typedef QMap<quint32, QVector<QPointF> > Outlines;
+
+static bool readReference(const char* fileName, Outlines& outlines) {
+    std::ifstream in(fileName);
+    if (!in) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string field;
+        long long detid = 0;
+        QVector<float> xs, ys;
+        for (int i = 0; fields >> field; i++) {
+            if (i == 0)          detid = atoll(field.c_str());
+            else if (i % 2 == 0) xs.push_back(strtod(field.c_str(), NULL));
+            else                 ys.push_back(strtod(field.c_str(), NULL));
+        }
+        if (detid == 0 || xs.size() != ys.size() || xs.empty() || xs.size() > TkMapGeometry::maxPoints) continue;
+
+        QVector<QPointF> points;
+        for (int i = 0; i < xs.size(); i++) points.push_back(QPointF(xs[i], ys[i]));
+        outlines[static_cast<quint32>(detid)] = points;
+    }
+    return true;
+}
+
+static int compare(const Outlines& reference, const TkMapGeometry& geometry, const char* source) {
+    int errors = 0;
+    if (geometry.size() != reference.size()) {
+        std::cerr << source << " : " << geometry.size() << " modules instead of " << reference.size() << std::endl;
+        errors++;
+    }
+    for (Outlines::const_iterator it = reference.constBegin(); it != reference.constEnd(); ++it) {
+        const TkMapGeometry::Module* module = geometry.find(it.key());
+        if (module == NULL) {
+            std::cerr << source << " : detid " << it.key() << " is missing" << std::endl;
+            errors++;
+            continue;
+        }
+        bool same = int(module->nPoints) == it.value().size();
+        for (int i = 0; same && i < it.value().size(); i++) {
+            same = module->x[i] == float(it.value()[i].x()) && module->y[i] == float(it.value()[i].y());
+        }
+        if (!same) {
+            std::cerr << source << " : outline of detid " << it.key() << " differs" << std::endl;
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage : " << argv[0] << " <ascii layout>" << std::endl;
+        return 1;
+    }
+
+    Outlines reference;
+    if (!readReference(argv[1], reference) || reference.isEmpty()) {
+        std::cerr << "Could not read tk map layout file " << argv[1] << std::endl;
+        return 1;
+    }
+
+    TkMapGeometry ascii;
+    if (!ascii.loadAscii(argv[1])) {
+        std::cerr << "Could not parse tk map layout file " << argv[1] << std::endl;
+        return 1;
+    }
+    int errors = compare(reference, ascii, "ASCII");
+
+    QString table = "tkmapcheck.bin";
+    if (!ascii.saveBinary(table)) {
+        std::cerr << "Could not write tk map layout table " << qPrintable(table) << std::endl;
+        return 1;
+    }
+    {
+        TkMapGeometry binary;
+        if (!binary.loadBinary(table)) {
+            std::cerr << "Could not map tk map layout table " << qPrintable(table) << std::endl;
+            errors++;
+        }
+        else errors += compare(reference, binary, "binary");
+    }
+    QFile::remove(table);
+
+    if (errors) {
+        std::cerr << errors << " mismatches" << std::endl;
+        return 1;
+    }
+    std::cout << "All " << reference.size() << " outlines match" << std::endl;
+    return 0;
+}
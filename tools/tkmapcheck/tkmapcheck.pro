@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = tkmapcheck
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+INCLUDEPATH += ../..
+
+OBJECTS_DIR = .obj
+
+HEADERS += ../../TkMapGeometry.h
+
+SOURCES += ../../TkMapGeometry.cpp \
+           tkmapcheck.cpp
@@ -0,0 +1,28 @@
+#include "TkMapGeometry.h"
+
+#include <iostream>
+
+/*
+ * Converts the ASCII tracker map layout (tkmap_bare) into the binary
+ * table loaded by TkMapGeometry
+ *
+ * usage : tkmapconv <ascii layout> <binary table>
+ */
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage : " << argv[0] << " <ascii layout> <binary table>" << std::endl;
+        return 1;
+    }
+
+    TkMapGeometry geometry;
+    if (!geometry.loadAscii(argv[1])) {
+        std::cerr << "Could not open tk map layout file " << argv[1] << std::endl;
+        return 1;
+    }
+    if (!geometry.saveBinary(argv[2])) {
+        std::cerr << "Could not write tk map layout table " << argv[2] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << geometry.size() << " modules to " << argv[2] << std::endl;
+    return 0;
+}
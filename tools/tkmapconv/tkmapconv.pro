@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = tkmapconv
+CONFIG += console
+CONFIG -= app_bundle
+QT -= gui
+
+INCLUDEPATH += ../..
+
+OBJECTS_DIR = .obj
+
+HEADERS += ../../TkMapGeometry.h
+
+SOURCES += ../../TkMapGeometry.cpp \
+           tkmapconv.cpp